@@ -1,36 +1,30 @@
 #ifndef LOGGING_PLUS_PLUS_LOG_HANDLER_H_
 #define LOGGING_PLUS_PLUS_LOG_HANDLER_H_
 
-#include <fstream>
+#include <atomic>
+#include <chrono>
 #include <map>
-#include <deque>
+#include <memory>
+#include <string>
+#include <vector>
 #include <mutex>
 #include <condition_variable>
+#include <deque>
+#include <future>
 #include <thread>
+#include "log_record.h"
+#include "log_sink.h"
 
 namespace logger {
 
-enum class LogLevel { TRACE = 0, DEBUG = 1, INFO = 2, WARN = 3, ERROR = 4 };
-
-inline std::string GetLogLevel(const LogLevel &level) {
-  switch (level) {
-    case LogLevel::TRACE:
-      return "TRACE";
-    case LogLevel::DEBUG:
-      return "DEBUG";
-    case LogLevel::INFO:
-      return "INFO";
-    case LogLevel::WARN:
-      return "WARN";
-    case LogLevel::ERROR:
-      return "ERROR";
-    default:
-      throw;
-  }
-}
+class ConfigWatcher;
+class EventCount;
+class FlightRecorder;
+class LatencyHistogram;
 
 /**
- * Singleton class
+ * A logger with its own level, sinks, queue and output thread.
+ * GetHandler() returns the default one, GetHandler(name) a named one.
  */
 class LogHandler {
  public:
@@ -38,66 +32,221 @@ class LogHandler {
   LogHandler &operator=(const LogHandler &) = delete;
   ~LogHandler();
 
-  struct OutputEntity;
-
   void Init();
 
-  // configuration
+  // configuration. Sinks, levels, batching, flushing and durability may
+  // change while running, from the next batch on. The flight recorder,
+  // early buffer and histogram settings only count before Init().
+  void AddSink(const std::shared_ptr<Sink> &);
+  void RemoveSink(const std::shared_ptr<Sink> &);
+  void ClearSinks();
+  // the default sinks: turning console or file output on and off replaces
+  // every ConsoleSink or FileSink, and so does the file
   enum class Output { FILE, CONSOLE };
   void set_output(const Output &, const bool);
   void set_log_file(const std::string &);
+  // keep the log directory under max_dir_size bytes and at most
+  // max_rotated_files rotated copies, 0 for no limit, see
+  // FileSink::set_retention(). For the FileSinks made by the setters above
+  // and the config file, the current ones are replaced like set_log_file()
+  void set_log_retention(const std::uint64_t max_dir_size,
+                         const unsigned max_rotated_files);
   void set_log_level(const LogLevel &);
-  void set_flush_frequency(const unsigned);
+  void set_flush_frequency(const unsigned);  // seconds
+  void set_flush_interval(const std::chrono::microseconds &);
+  // wait between min_interval and the flush interval: shorter while the
+  // queue is shallow, longer while batches fill up
+  void set_adaptive_flush(const bool,
+                          const std::chrono::microseconds &min_interval =
+                              std::chrono::microseconds(100));
   void set_max_buffer_size(const unsigned);
+  // bytes the queued records may take, 0 for no limit. Over it Log()
+  // BLOCKs until the output thread caught up, or DROPs the record
+  enum class Overflow { BLOCK, DROP };
+  void set_queue_budget(const std::size_t bytes,
+                        const Overflow &overflow = Overflow::BLOCK);
+  void set_priority_level(const LogLevel &);
+  // NONE: leave it to the kernel, PERIODIC: fsync every sync period,
+  // WARN: fsync every batch holding a WARN or ERROR record
+  enum class Durability { NONE, PERIODIC, WARN };
+  void set_durability(const Durability &);
+  void set_sync_period(const unsigned milliseconds);
+  void set_flight_recorder_size(const unsigned);
+  // records kept when logged before Init(), written first by Init()
+  void set_early_buffer_size(const unsigned);
+  void set_flight_recorder_level(const LogLevel &);
+  // turns the flight recorder on, before Init()
+  void set_crash_dump_file(const std::string &);
+  // time every Log() call into a histogram, see Stats
+  void set_latency_histogram(const bool);
+  // settings read by Init() on top of the ones set, and read again by the
+  // output thread whenever the file changes. Format in lib/config_file.h
+  void set_config_file(const std::string &);
+  // reopen the sinks' files on SIGHUP, as logrotate's postrotate asks.
+  // Renamed files are noticed once per flush interval anyway.
+  void set_reopen_on_sighup(const bool);
   // main method
-  void Log(const LogLevel &, const std::string &msg, const std::string &file,
-           const std::string &func, const unsigned line);
+  void Log(const LogRecord &);
+  // wait until everything logged so far is fsynced, concurrent callers
+  // share one fsync. A sink that can't write keeps it waiting until it can
+  // or until Shutdown()
+  void Sync();
+  // wait until everything logged so far went through the sinks' Flush(),
+  // false if it took longer than timeout
+  void Flush();
+  bool Flush(const std::chrono::milliseconds &timeout);
+  std::future<void> FlushAsync();
+  // stop taking records, write what is queued and close the sinks. Records
+  // still queued after timeout are dropped, returns how many. The
+  // destructor does it too, with a 5 seconds timeout.
+  std::uint64_t Shutdown(const std::chrono::milliseconds &timeout);
+
+  // counters since Init, added up when asked for
+  struct Stats {
+    std::uint64_t enqueued;       // records queued for the sinks
+    std::uint64_t dropped;        // records lost before the queue
+    std::uint64_t records;        // records handed to the sinks
+    std::uint64_t bytes_written;  // by every sink
+    std::uint64_t lost_bytes;     // given up by sinks, e.g. on a full disk
+    std::uint64_t batches;
+    std::size_t last_batch_size;
+    std::size_t max_batch_size;
+    std::size_t max_queue_depth;  // records waiting for the output thread
+    std::chrono::microseconds last_latency;  // oldest record to written
+    std::chrono::microseconds max_latency;
+    std::chrono::microseconds write_time;      // total in Sink::Write()
+    std::chrono::microseconds max_write_time;  // of one batch
+    std::chrono::microseconds flush_time;      // total in Flush() or Sync()
+    std::chrono::microseconds max_flush_time;  // of one batch
+    // time spent in Log() by the calling thread, histogram mode only
+    std::uint64_t log_calls;
+    std::chrono::nanoseconds log_p50;
+    std::chrono::nanoseconds log_p99;
+    std::chrono::nanoseconds log_p999;
+    std::chrono::nanoseconds log_max;
+    std::chrono::microseconds interval;  // current wait of the output thread
+  };
+  Stats stats() const;
   // other helpers
+  bool IsLevelEnabled(const LogLevel &level) const {
+    return level >= min_level_.load(std::memory_order_relaxed);
+  }
   static bool IsLevelAvailable(const LogLevel &level) {
-    return level >= GetHandler().log_level_;
+    return GetHandler().IsLevelEnabled(level);
+  }
+  const std::string &name() const { return name_; }
+  // bytes taken by records queued or being written right now
+  std::size_t queue_usage() const {
+    return queued_bytes_.load(std::memory_order_relaxed);
   }
-  // return a static global log handler, singleton
+  // return a static global log handler
   static LogHandler &GetHandler() {
-    static LogHandler instance;
+    static LogHandler instance("");
     return instance;
   }
+  // return the log handler registered as name, created on first use.
+  // The lookup locks a registry, keep the returned reference around.
+  static LogHandler &GetHandler(const std::string &name);
 
-  const unsigned kMaxMsgSize;  // Max single log msg size
  private:
-  LogHandler();
+  explicit LogHandler(const std::string &name);
+  template <typename Modify>
+  void Reconfigure(Modify modify);
+  template <typename SinkType>
+  void ReplaceSinks(const std::shared_ptr<Sink> &);
+  std::shared_ptr<Sink> MakeFileSink() const;
+  void LoadConfigFile(const bool is_running);
+  void CheckConfigFile();
+  void Enqueue(const LogRecord &);
+  bool BufferEarly(const LogRecord &);
+  void QueueEarlyRecords();
+  bool IsBatchReady() const;
   void StartOutputThread();
-  void FreshCurrentTime();
-  void OpenLogStream() const;
-  void OutputToConsole(const std::string &) const;
-  void OutputToFile(const std::string &) const;
-  OutputEntity FormatOutput(const LogLevel &level, const std::string &msg,
-                            const std::string &file, const std::string &func,
-                            const unsigned line) const;
+  bool IsSyncDue(const std::chrono::steady_clock::time_point &) const;
+  void UpdateStats(const std::size_t batch_size, const std::size_t queue_depth,
+                   const std::uint64_t bytes_written,
+                   const std::uint64_t lost_bytes,
+                   const std::int64_t oldest_time,
+                   const std::chrono::microseconds &write_time,
+                   const std::chrono::microseconds &flush_time,
+                   const std::chrono::microseconds &interval);
 
   // running status control
   mutable std::mutex log_mtx_;
   mutable std::mutex output_mtx_;
-  std::condition_variable log_cv_;     // condition: logWriteBuffer
   std::condition_variable output_cv_;  // condition: isEngineReady
+  // condition: synced_seq_, is_output_done_
+  std::condition_variable sync_cv_;
+  std::condition_variable space_cv_;   // condition: queued_bytes_
+  // wakes up the output thread, without a syscall while it is busy
+  std::unique_ptr<EventCount> log_event_;
+  mutable std::mutex stats_mtx_;
   bool is_output_ready_;
   bool is_close_output_;
-  bool is_stop_;
+  std::atomic<bool> is_stop_;  // read without the lock by Enqueue()
+  bool is_closed_;          // Shutdown() began, Log() drops
+  bool is_abort_output_;    // Shutdown() timed out, drop the queue
+  bool is_output_done_;     // sinks closed, output thread ends
+  std::uint64_t lost_records_;  // dropped by Shutdown() timing out
   std::thread output_thread_;
 
-  // log configuration
-  unsigned max_buffer_size_;  // max logWriteBuffer
-  std::chrono::seconds
-      flush_frequency_;  // output engine flush buffer frequency
-  std::string log_dir_;
-  std::string log_file_;
-  mutable std::ofstream log_stream_;
-  std::string current_time_;
-  LogLevel log_level_;             // limit log level
-  std::map<Output, bool> output_;  // limit output
+  // log configuration, an immutable snapshot every setter replaces.
+  // Producers read it with log_mtx_ held, the output thread also without,
+  // so replaced snapshots live until it comes back for its next batch.
+  struct Config;
+  const std::string name_;
+  const Config *config_;                         // under log_mtx_
+  std::vector<const Config *> retired_configs_;  // under log_mtx_
+  std::chrono::steady_clock::time_point last_sync_time_;
+  // after a sink failed to sync, no new try before sync_retry_time_
+  std::chrono::steady_clock::time_point sync_retry_time_;
+  std::chrono::milliseconds sync_retry_backoff_;
+  // the snapshot's log level, and the lowest level either written or
+  // recorded: read without the lock by the filters
+  std::atomic<LogLevel> log_level_;
+  std::atomic<LogLevel> min_level_;
+  std::string log_path_;            // of the FileSink set_output() adds
+  std::uint64_t max_dir_size_;      // retention of the FileSinks made here
+  unsigned max_rotated_files_;
+  unsigned flight_recorder_size_;   // records kept for crash dumps
+  LogLevel flight_recorder_level_;  // recorded even below log_level_
+  std::string crash_dump_file_;
+  std::unique_ptr<FlightRecorder> flight_recorder_;
+  std::unique_ptr<LatencyHistogram> latency_histogram_;
+  std::string config_file_;
+  bool is_reopen_on_sighup_;
+  // output thread side, with the sinks made for the sink lines of the file
+  std::unique_ptr<ConfigWatcher> config_watcher_;
+  std::chrono::steady_clock::time_point next_config_check_;
+  std::map<std::string, std::shared_ptr<Sink>> file_sinks_;
+
+  // records are numbered in the order they are queued
+  std::uint64_t queued_seq_;          // last queued record
+  std::uint64_t written_seq_;         // all records up to it are taken
+  std::uint64_t synced_seq_;          // last fsynced record
+  std::uint64_t sync_requested_seq_;  // last record a Sync() waits for
+  std::uint64_t flushed_seq_;         // all records up to it are flushed
+  // last record of every FlushAsync() still waiting, in order
+  std::deque<std::pair<std::uint64_t, std::promise<void>>> flush_barriers_;
+
+  // producers count into the shard of their thread, no shared cache line
+  struct CounterShard;
+  std::unique_ptr<CounterShard[]> counter_shards_;
+
+  // records logged before Init(), allocated by the first of them
+  struct EarlySlot;
+  unsigned early_buffer_size_;
+  std::atomic<unsigned> early_next_;  // next slot, kEarlyClosed by Init()
+  std::atomic<EarlySlot *> early_slots_;
+  Stats stats_;  // output thread side
 
-  // log buffer
-  std::deque<OutputEntity> log_read_buffer_;
-  std::deque<OutputEntity> log_write_buffer_;
+  // log buffer, records are packed without their unused args bytes
+  std::atomic<std::size_t> queued_bytes_;
+  std::string log_read_buffer_;
+  std::string log_write_buffer_;
+  unsigned log_read_count_;
+  unsigned log_priority_count_;  // records in the queue that can't wait
+  std::vector<LogRecord> batch_;  // unpacked write buffers
 };
 }
 
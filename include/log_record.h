@@ -0,0 +1,127 @@
+#ifndef LOGGING_PLUS_PLUS_LOG_RECORD_H_
+#define LOGGING_PLUS_PLUS_LOG_RECORD_H_
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+namespace logger {
+
+enum class LogLevel { TRACE = 0, DEBUG = 1, INFO = 2, WARN = 3, ERROR = 4 };
+
+inline std::string GetLogLevel(const LogLevel &level) {
+  switch (level) {
+    case LogLevel::TRACE:
+      return "TRACE";
+    case LogLevel::DEBUG:
+      return "DEBUG";
+    case LogLevel::INFO:
+      return "INFO";
+    case LogLevel::WARN:
+      return "WARN";
+    case LogLevel::ERROR:
+      return "ERROR";
+    default:
+      throw;
+  }
+}
+
+constexpr unsigned kMaxMsgSize = 300;   // Max single formatted log line
+constexpr unsigned kMaxArgsSize = 300;  // Max encoded arguments per record
+
+/**
+ * Argument type tags, every encoded argument starts with one of them
+ */
+enum ArgType : char {
+  kArgSigned = 'i',    // zigzag varint
+  kArgUnsigned = 'u',  // varint
+  kArgDouble = 'd',    // 8 bytes, little endian IEEE 754
+  kArgString = 's'     // varint length + bytes
+};
+
+/**
+ * Append a LEB128 varint, return the number of bytes written
+ */
+inline std::size_t EncodeVarint(std::uint64_t value, char *out) {
+  std::size_t size = 0;
+  while (value >= 0x80) {
+    out[size++] = static_cast<char>(value | 0x80);
+    value >>= 7;
+  }
+  out[size++] = static_cast<char>(value);
+  return size;
+}
+
+/**
+ * Read a LEB128 varint and advance pos, return false on truncated input
+ */
+inline bool DecodeVarint(const char *&pos, const char *end,
+                         std::uint64_t &value) {
+  value = 0;
+  for (unsigned shift = 0; pos < end && shift < 64; shift += 7) {
+    const auto byte = static_cast<unsigned char>(*pos++);
+    value |= static_cast<std::uint64_t>(byte & 0x7f) << shift;
+    if (!(byte & 0x80)) return true;
+  }
+  return false;
+}
+
+inline std::uint64_t ZigZagEncode(std::int64_t value) {
+  return (static_cast<std::uint64_t>(value) << 1) ^
+         static_cast<std::uint64_t>(value >> 63);
+}
+
+inline std::int64_t ZigZagDecode(std::uint64_t value) {
+  return static_cast<std::int64_t>(value >> 1) ^
+         -static_cast<std::int64_t>(value & 1);
+}
+
+/**
+ * One log message as it travels from LogStream to the outputs.
+ * Arguments are kept encoded, text formatting happens on the output thread.
+ */
+struct LogRecord {
+  LogLevel level;
+  unsigned line;
+  const char *file;  // call site, must outlive the record (__FILE__)
+  const char *func;  // call site, must outlive the record (__func__)
+  std::int64_t time;  // microseconds since epoch
+  std::uint16_t args_size;
+  char args[kMaxArgsSize];
+
+  void AppendSigned(std::int64_t value) {
+    if (args_size + 11u > kMaxArgsSize) return;
+    args[args_size++] = kArgSigned;
+    args_size += EncodeVarint(ZigZagEncode(value), args + args_size);
+  }
+
+  void AppendUnsigned(std::uint64_t value) {
+    if (args_size + 11u > kMaxArgsSize) return;
+    args[args_size++] = kArgUnsigned;
+    args_size += EncodeVarint(value, args + args_size);
+  }
+
+  void AppendDouble(double value) {
+    if (args_size + 9u > kMaxArgsSize) return;
+    std::uint64_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    args[args_size++] = kArgDouble;
+    for (unsigned idx = 0; idx < 8; ++idx) {
+      args[args_size++] = static_cast<char>(bits >> (idx * 8));
+    }
+  }
+
+  // strings that don't fit are truncated
+  void AppendString(const char *value, std::size_t size) {
+    if (args_size + 3u > kMaxArgsSize) return;
+    const std::size_t room = kMaxArgsSize - args_size - 3;
+    if (size > room) size = room;
+    args[args_size++] = kArgString;
+    args_size += EncodeVarint(size, args + args_size);
+    std::memcpy(args + args_size, value, size);
+    args_size += size;
+  }
+};
+}
+
+#endif /* LOGGING_PLUS_PLUS_LOG_RECORD_H_ */
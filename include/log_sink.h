@@ -0,0 +1,216 @@
+#ifndef LOGGING_PLUS_PLUS_LOG_SINK_H_
+#define LOGGING_PLUS_PLUS_LOG_SINK_H_
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <string>
+#include "log_record.h"
+
+namespace logger {
+
+class LogFormatter;
+class BinaryLogWriter;
+class LogPruner;
+struct ShmRingHeader;
+
+/**
+ * Output destination of the log handler.
+ * Open() runs in LogHandler::Init(), or in AddSink() once running.
+ * Write() and Flush() run on the output thread only, once per batch.
+ * Sync() is asked for by the durability setting instead of Flush(), it
+ * should survive a power loss and tells whether everything written so far
+ * did. Close() runs last on the output thread, at
+ * LogHandler::Shutdown() or after RemoveSink(). Between batches, the
+ * output thread Reopen()s a sink on SIGHUP or once IsMoved() tells its
+ * file was renamed, e.g. by logrotate.
+ * Sinks add what reaches their destination to bytes_written_, and what
+ * they gave up on to lost_bytes_.
+ */
+class Sink {
+ public:
+  Sink() : bytes_written_(0), lost_bytes_(0) {}
+  virtual ~Sink() {}
+
+  virtual void Open() {}
+  virtual void Write(const LogRecord *records, std::size_t count) = 0;
+  virtual void Flush() = 0;
+  virtual bool Sync() {
+    Flush();
+    return true;
+  }
+  virtual void Close() { Flush(); }
+  virtual bool IsMoved() const { return false; }
+  virtual void Reopen() {}
+
+  // read them on the output thread
+  std::uint64_t bytes_written() const { return bytes_written_; }
+  std::uint64_t lost_bytes() const { return lost_bytes_; }
+
+ protected:
+  std::uint64_t bytes_written_;
+  std::uint64_t lost_bytes_;
+};
+
+/**
+ * Discards every record, measures the logger without any I/O
+ */
+class NullSink : public Sink {
+ public:
+  void Write(const LogRecord *, std::size_t) override {}
+  void Flush() override {}
+};
+
+/**
+ * Colored text lines on stdout
+ */
+class ConsoleSink : public Sink {
+ public:
+  ConsoleSink();
+  ~ConsoleSink();
+
+  void Write(const LogRecord *records, std::size_t count) override;
+  void Flush() override;
+
+ private:
+  std::unique_ptr<LogFormatter> formatter_;
+  std::string buffer_;
+};
+
+/**
+ * Text lines appended to a log file, the directory is created if needed.
+ * When writing fails, e.g. on a full disk, up to max_spill_size bytes wait
+ * in memory and writing is retried with a backoff. Lines beyond are
+ * dropped and counted in lost_bytes_.
+ */
+class FileSink : public Sink {
+ public:
+  explicit FileSink(const std::string &log_path,
+                    std::size_t max_spill_size = 4 << 20);
+  ~FileSink();
+
+  void Open() override;
+  void Write(const LogRecord *records, std::size_t count) override;
+  void Flush() override;
+  bool Sync() override;
+  void Close() override;
+  bool IsMoved() const override;
+  // the old file stays if the new one can't be opened
+  void Reopen() override;
+
+  // keep the log directory under max_dir_size bytes and at most
+  // max_rotated_files rotated copies of the file, 0 for no limit. A helper
+  // thread deletes the oldest copies from Open() on, see LogPruner.
+  void set_retention(std::uint64_t max_dir_size, unsigned max_rotated_files);
+
+ private:
+  std::string log_dir_;
+  std::string log_file_;
+  int log_fd_;
+  std::uint64_t log_device_;  // of the open file, to notice a rename
+  std::uint64_t log_inode_;
+  std::uint64_t max_dir_size_;
+  unsigned max_rotated_files_;
+  std::unique_ptr<LogPruner> pruner_;
+  const std::size_t max_spill_size_;
+  bool is_failing_;  // the last write failed, buffer_ holds the spill
+  std::chrono::steady_clock::time_point next_retry_time_;
+  std::chrono::milliseconds retry_backoff_;
+  std::unique_ptr<LogFormatter> formatter_;
+  std::string buffer_;
+};
+
+/**
+ * Binary blocks appended to a log file, read them with logpp-decode
+ */
+class BinaryFileSink : public Sink {
+ public:
+  explicit BinaryFileSink(const std::string &log_path);
+  ~BinaryFileSink();
+
+  void Open() override;
+  void Write(const LogRecord *records, std::size_t count) override;
+  void Flush() override;
+  bool Sync() override;
+  void Close() override;
+  bool IsMoved() const override;
+  // the old file stays if the new one can't be opened
+  void Reopen() override;
+
+ private:
+  std::string log_dir_;
+  std::string log_file_;
+  int log_fd_;
+  std::uint64_t log_device_;  // of the open file, to notice a rename
+  std::uint64_t log_inode_;
+  std::unique_ptr<BinaryLogWriter> writer_;
+  std::string buffer_;
+};
+
+/**
+ * Text lines streamed to a local collector over an AF_UNIX stream socket.
+ * Sending never blocks: lines wait in a bounded buffer while the collector
+ * is slow or gone, reconnection is retried with a backoff, and lines that
+ * don't fit the buffer are dropped and counted.
+ */
+class UnixSocketSink : public Sink {
+ public:
+  explicit UnixSocketSink(const std::string &socket_path,
+                          std::size_t max_pending_size = 4 << 20);
+  ~UnixSocketSink();
+
+  void Write(const LogRecord *records, std::size_t count) override;
+  void Flush() override;
+  void Close() override;
+
+  bool is_connected() const { return is_connected_; }
+  std::size_t dropped_records() const { return dropped_records_; }
+
+ private:
+  bool Connect();
+  void Disconnect();
+  void Send();
+
+  const std::string socket_path_;
+  const std::size_t max_pending_size_;
+  int socket_fd_;
+  std::chrono::steady_clock::time_point next_connect_time_;
+  std::chrono::milliseconds connect_backoff_;
+  bool is_line_started_;  // a line was sent partially
+  std::atomic<bool> is_connected_;
+  std::atomic<std::size_t> dropped_records_;
+  std::unique_ptr<LogFormatter> formatter_;
+  std::string line_;
+  std::string pending_;
+};
+
+/**
+ * Text lines published into a POSIX shared memory ring (shm_open name),
+ * read them from another process with ShmRingReader or logpp-shm-tail.
+ * The oldest lines are overwritten when readers fall behind.
+ */
+class ShmRingSink : public Sink {
+ public:
+  explicit ShmRingSink(const std::string &name,
+                       std::uint32_t slot_count = 4096,
+                       std::uint32_t slot_size = 512);
+  ~ShmRingSink();
+
+  void Open() override;
+  void Write(const LogRecord *records, std::size_t count) override;
+  void Flush() override {}
+  // unlinks the ring, attached readers keep what they mapped
+  void Close() override;
+
+ private:
+  const std::string name_;
+  const std::uint32_t slot_count_;
+  const std::uint32_t slot_size_;
+  ShmRingHeader *ring_;
+  std::size_t ring_size_;
+  std::unique_ptr<LogFormatter> formatter_;
+  std::string line_;
+};
+}
+
+#endif /* LOGGING_PLUS_PLUS_LOG_SINK_H_ */
@@ -1,6 +1,7 @@
 #ifndef LOGGING_PLUS_PLUS_LOG_STREAM_H_
 #define LOGGING_PLUS_PLUS_LOG_STREAM_H_
 
+#include <type_traits>
 #include "log_handler.h"
 
 namespace logger {
@@ -9,7 +10,8 @@ namespace logger {
  */
 class LogStream {
  public:
-  LogStream(const LogLevel &, const std::string &, const std::string &,
+  LogStream(const LogLevel &, const char *, const char *, const unsigned);
+  LogStream(LogHandler &, const LogLevel &, const char *, const char *,
             const unsigned);
   LogStream(const LogStream &) = delete;
   LogStream &operator=(const LogStream &) = delete;
@@ -17,7 +19,10 @@ class LogStream {
 
   template <typename T>
   LogStream &operator<<(const T &msg) {
-    log_msg_ += std::to_string(msg);
+    // unary plus applies the same promotions std::to_string would
+    using Promoted = decltype(+msg);
+    Append(+msg, std::is_floating_point<Promoted>(),
+           std::is_signed<Promoted>());
     return *this;
   }
   LogStream &operator<<(const std::string &);
@@ -25,12 +30,22 @@ class LogStream {
   LogStream &operator<<(char *);
 
  private:
+  template <typename T, typename Signed>
+  void Append(const T &msg, std::true_type, Signed) {
+    record_.AppendDouble(msg);
+  }
+  template <typename T>
+  void Append(const T &msg, std::false_type, std::true_type) {
+    record_.AppendSigned(msg);
+  }
+  template <typename T>
+  void Append(const T &msg, std::false_type, std::false_type) {
+    record_.AppendUnsigned(msg);
+  }
+  void Append(const long double &, std::true_type, std::true_type);
+
   LogHandler &log_handler_;
-  LogLevel log_level_;
-  std::string filename;
-  std::string funcname;
-  unsigned line;
-  std::string log_msg_;
+  LogRecord record_;
 };
 }
 
@@ -9,4 +9,11 @@
   else                                                \
   ::logger::LogStream(level, __FILE__, __func__, __LINE__)
 
+// log to a named handler, e.g. LogTo(db_logging, WARN) << "slow query";
+#define LogTo(handler, level)                  \
+  if (!(handler).IsLevelEnabled(level))        \
+    ;                                          \
+  else                                         \
+  ::logger::LogStream(handler, level, __FILE__, __func__, __LINE__)
+
 #endif /* LOGGING_PLUS_PLUS_LOGGER_H_ */
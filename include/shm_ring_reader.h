@@ -0,0 +1,44 @@
+#ifndef LOGGING_PLUS_PLUS_SHM_RING_READER_H_
+#define LOGGING_PLUS_PLUS_SHM_RING_READER_H_
+
+#include <cstdint>
+#include <string>
+
+namespace logger {
+
+struct ShmRingHeader;
+
+/**
+ * Reads the lines a ShmRingSink publishes, from any process.
+ * Reading is plain memory access, no syscall once the ring is open.
+ * A reader that falls more than a ring behind skips the overwritten
+ * records and counts them as lost.
+ */
+class ShmRingReader {
+ public:
+  ShmRingReader();
+  ShmRingReader(const ShmRingReader &) = delete;
+  ShmRingReader &operator=(const ShmRingReader &) = delete;
+  ~ShmRingReader();
+
+  // attach to a ring, false if no sink published it
+  bool Open(const std::string &name);
+  // copy the next line to out, false if there is none yet. Attaches again
+  // when the ring was made anew with another geometry
+  bool Next(std::string &out);
+
+  std::uint64_t lost_records() const { return lost_records_; }
+
+ private:
+  std::string name_;
+  ShmRingHeader *ring_;
+  std::size_t ring_size_;
+  // as checked against ring_size_ by Open(), not as in the header now
+  std::uint32_t slot_count_;
+  std::uint32_t slot_size_;
+  std::uint64_t next_seq_;
+  std::uint64_t lost_records_;
+};
+}
+
+#endif /* LOGGING_PLUS_PLUS_SHM_RING_READER_H_ */
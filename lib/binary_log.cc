@@ -0,0 +1,168 @@
+#include "binary_log.h"
+
+namespace logger {
+
+namespace {
+
+void PutFixed(std::uint64_t value, std::size_t size, std::string& out) {
+  for (std::size_t idx = 0; idx < size; ++idx) {
+    out += static_cast<char>(value >> (idx * 8));
+  }
+}
+
+std::uint64_t GetFixed(const char* pos, std::size_t size) {
+  std::uint64_t value = 0;
+  for (std::size_t idx = 0; idx < size; ++idx) {
+    value |= static_cast<std::uint64_t>(static_cast<unsigned char>(pos[idx]))
+             << (idx * 8);
+  }
+  return value;
+}
+
+void PutVarint(std::uint64_t value, std::string& out) {
+  char buffer[10];
+  out.append(buffer, EncodeVarint(value, buffer));
+}
+
+void PutString(const char* str, std::string& out) {
+  const std::size_t size = std::strlen(str);
+  PutVarint(size, out);
+  out.append(str, size);
+}
+
+bool GetString(const char*& pos, const char* end, std::string& str) {
+  std::uint64_t size;
+  if (!DecodeVarint(pos, end, size) ||
+      size > static_cast<std::uint64_t>(end - pos)) {
+    return false;
+  }
+  str.assign(pos, size);
+  pos += size;
+  return true;
+}
+}
+
+BinaryLogWriter::BinaryLogWriter()
+    : sites_(), dict_(), data_(), count_(0), base_time_(0), last_time_(0) {}
+
+void BinaryLogWriter::StartSegment(std::string& out) {
+  FinishBlock(out);
+  sites_.clear();
+  out.append(kSegmentMagic, kSegmentMagicSize);
+  out += static_cast<char>(kBinaryVersion);
+}
+
+void BinaryLogWriter::Add(const LogRecord& record) {
+  const CallSite site{record.file, record.func, record.line};
+  auto found = sites_.find(site);
+  if (found == sites_.end()) {
+    const auto id = static_cast<std::uint32_t>(sites_.size());
+    found = sites_.emplace(site, id).first;
+    PutVarint(id, dict_);
+    PutVarint(record.line, dict_);
+    PutString(record.file, dict_);
+    PutString(record.func, dict_);
+  }
+
+  if (count_ == 0) {
+    base_time_ = record.time;
+    last_time_ = record.time;
+  }
+  PutVarint(found->second, data_);
+  data_ += static_cast<char>(record.level);
+  PutVarint(ZigZagEncode(record.time - last_time_), data_);
+  PutVarint(record.args_size, data_);
+  data_.append(record.args, record.args_size);
+  last_time_ = record.time;
+  ++count_;
+}
+
+void BinaryLogWriter::FinishBlock(std::string& out) {
+  if (count_ == 0) return;
+  PutFixed(kBlockMagic, 4, out);
+  PutFixed(dict_.size(), 4, out);
+  PutFixed(data_.size(), 4, out);
+  PutFixed(count_, 4, out);
+  PutFixed(static_cast<std::uint64_t>(base_time_), 8, out);
+  out += dict_;
+  out += data_;
+  dict_.clear();
+  data_.clear();
+  count_ = 0;
+}
+
+bool IsSegmentHeader(const char* pos, std::size_t size) {
+  return size >= kSegmentHeaderSize &&
+         std::memcmp(pos, kSegmentMagic, kSegmentMagicSize) == 0 &&
+         static_cast<unsigned char>(pos[kSegmentMagicSize]) == kBinaryVersion;
+}
+
+bool ReadBlockHeader(const char* pos, std::size_t size, BlockHeader& header) {
+  if (size < kBlockHeaderSize || GetFixed(pos, 4) != kBlockMagic) {
+    return false;
+  }
+  header.dict_size = static_cast<std::uint32_t>(GetFixed(pos + 4, 4));
+  header.data_size = static_cast<std::uint32_t>(GetFixed(pos + 8, 4));
+  header.count = static_cast<std::uint32_t>(GetFixed(pos + 12, 4));
+  header.base_time = static_cast<std::int64_t>(GetFixed(pos + 16, 8));
+  return static_cast<std::uint64_t>(header.dict_size) + header.data_size <=
+         size - kBlockHeaderSize;
+}
+
+bool ReadDictionary(const char* dict, std::size_t size,
+                    Dictionary& dictionary) {
+  const char* pos = dict;
+  const char* end = dict + size;
+  while (pos < end) {
+    std::uint64_t id;
+    std::uint64_t line;
+    CallSiteInfo site;
+    if (!DecodeVarint(pos, end, id) || !DecodeVarint(pos, end, line) ||
+        !GetString(pos, end, site.file) || !GetString(pos, end, site.func) ||
+        id != dictionary.size()) {
+      return false;
+    }
+    site.line = static_cast<unsigned>(line);
+    dictionary.push_back(std::move(site));
+  }
+  return true;
+}
+
+bool DecodeBlockData(const char* data, const BlockHeader& header,
+                     const Dictionary& dictionary, LogFormatter& formatter,
+                     std::string& out) {
+  const char* pos = data;
+  const char* end = data + header.data_size;
+  std::int64_t time = header.base_time;
+  LogRecord record;
+  for (std::uint32_t idx = 0; idx < header.count; ++idx) {
+    std::uint64_t id;
+    std::uint64_t delta;
+    std::uint64_t args_size;
+    if (!DecodeVarint(pos, end, id) || id >= dictionary.size() ||
+        pos >= end) {
+      return false;
+    }
+    const auto level = static_cast<unsigned char>(*pos++);
+    if (level > static_cast<unsigned char>(LogLevel::ERROR) ||
+        !DecodeVarint(pos, end, delta) ||
+        !DecodeVarint(pos, end, args_size) || args_size > kMaxArgsSize ||
+        args_size > static_cast<std::uint64_t>(end - pos)) {
+      return false;
+    }
+    time += ZigZagDecode(delta);
+
+    const CallSiteInfo& site = dictionary[id];
+    record.level = static_cast<LogLevel>(level);
+    record.line = site.line;
+    record.file = site.file.c_str();
+    record.func = site.func.c_str();
+    record.time = time;
+    record.args_size = static_cast<std::uint16_t>(args_size);
+    std::memcpy(record.args, pos, args_size);
+    pos += args_size;
+    formatter.Format(record, false, out);
+  }
+  return pos == end;
+}
+}
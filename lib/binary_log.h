@@ -0,0 +1,99 @@
+#ifndef LOGGING_PLUS_PLUS_BINARY_LOG_H_
+#define LOGGING_PLUS_PLUS_BINARY_LOG_H_
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "../include/log_record.h"
+#include "log_format.h"
+
+namespace logger {
+
+/**
+ * Binary log layout, all fixed size integers are little endian:
+ *
+ *   file     := segment*
+ *   segment  := "LOGPPBIN" u8(version) block*
+ *   block    := u32(kBlockMagic) u32(dict_size) u32(data_size) u32(count)
+ *               i64(base_time) dict data
+ *   dict     := (varint(id) varint(line) str(file) str(func))*
+ *   data     := (varint(id) u8(level) zigzag(delta_us) varint(args_size)
+ *                args)*
+ *   str      := varint(size) bytes
+ *
+ * Every segment starts with an empty call-site dictionary, a call site is
+ * described once in the dict of the first block using it. Timestamps are
+ * deltas to the previous record of the block, starting from base_time.
+ */
+constexpr char kSegmentMagic[] = "LOGPPBIN";
+constexpr std::size_t kSegmentMagicSize = 8;
+constexpr std::size_t kSegmentHeaderSize = kSegmentMagicSize + 1;
+constexpr unsigned char kBinaryVersion = 1;
+constexpr std::uint32_t kBlockMagic = 0x4b4c4250;  // "PBLK"
+constexpr std::size_t kBlockHeaderSize = 24;
+
+/**
+ * Encode records into blocks, one block per output batch
+ */
+class BinaryLogWriter {
+ public:
+  BinaryLogWriter();
+
+  // start a new segment, forget every known call site
+  void StartSegment(std::string &out);
+  void Add(const LogRecord &record);
+  // append the pending block to out, nothing if it is empty
+  void FinishBlock(std::string &out);
+
+ private:
+  struct CallSite {
+    const char *file;
+    const char *func;
+    unsigned line;
+    bool operator==(const CallSite &other) const {
+      return file == other.file && func == other.func && line == other.line;
+    }
+  };
+  struct CallSiteHash {
+    std::size_t operator()(const CallSite &site) const {
+      return std::hash<const void *>()(site.file) * 31 +
+             std::hash<const void *>()(site.func) * 17 + site.line;
+    }
+  };
+
+  std::unordered_map<CallSite, std::uint32_t, CallSiteHash> sites_;
+  std::string dict_;
+  std::string data_;
+  std::uint32_t count_;
+  std::int64_t base_time_;
+  std::int64_t last_time_;
+};
+
+/**
+ * Call site metadata decoded from the dictionary
+ */
+struct CallSiteInfo {
+  std::string file;
+  std::string func;
+  unsigned line;
+};
+using Dictionary = std::vector<CallSiteInfo>;
+
+struct BlockHeader {
+  std::uint32_t dict_size;
+  std::uint32_t data_size;
+  std::uint32_t count;
+  std::int64_t base_time;
+};
+
+bool IsSegmentHeader(const char *pos, std::size_t size);
+bool ReadBlockHeader(const char *pos, std::size_t size, BlockHeader &header);
+// add the call sites of a dict section
+bool ReadDictionary(const char *dict, std::size_t size, Dictionary &dictionary);
+// append the text lines of a data section to out
+bool DecodeBlockData(const char *data, const BlockHeader &header,
+                     const Dictionary &dictionary, LogFormatter &formatter,
+                     std::string &out);
+}
+
+#endif /* LOGGING_PLUS_PLUS_BINARY_LOG_H_ */
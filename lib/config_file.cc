@@ -0,0 +1,220 @@
+#include <algorithm>
+#include <climits>
+#include <fstream>
+#include <stdexcept>
+#include <unistd.h>
+#include <sys/inotify.h>
+#include "config_file.h"
+#include "helper.h"
+
+namespace logger {
+
+namespace {
+
+const char* kSinkKinds[] = {"console", "null", "file", "binary", "unix",
+                            "shm"};
+// longer waits mean never anyway, and larger ones overflow the clocks
+const std::chrono::hours kMaxDuration(24);
+
+std::string Trim(const std::string& text) {
+  const std::size_t begin = text.find_first_not_of(" \t\r");
+  if (begin == std::string::npos) return "";
+  const std::size_t end = text.find_last_not_of(" \t\r");
+  return text.substr(begin, end - begin + 1);
+}
+
+LogLevel ParseLevel(const std::string& value) {
+  for (const LogLevel level : {LogLevel::TRACE, LogLevel::DEBUG,
+                               LogLevel::INFO, LogLevel::WARN,
+                               LogLevel::ERROR}) {
+    if (value == GetLogLevel(level)) return level;
+  }
+  throw std::invalid_argument("unknown level " + value);
+}
+
+std::uint64_t ParseNumber(const std::string& value) {
+  std::size_t end;
+  const unsigned long long number = std::stoull(value, &end);
+  if (end != value.size() || value[0] == '-') {
+    throw std::invalid_argument("not a number " + value);
+  }
+  return number;
+}
+
+/**
+ * A number of microseconds or milliseconds, capped at kMaxDuration
+ */
+template <typename Duration>
+Duration ParseDuration(const std::string& value) {
+  const std::uint64_t max_count = Duration(kMaxDuration).count();
+  return Duration(std::min(ParseNumber(value), max_count));
+}
+
+/**
+ * A sink line is a kind, and a path for every kind but console and null
+ */
+void CheckSink(const std::string& spec) {
+  const std::size_t space = spec.find(' ');
+  const std::string kind = spec.substr(0, space);
+  for (const char* known : kSinkKinds) {
+    if (kind != known) continue;
+    const bool has_path = space != std::string::npos;
+    if (has_path != (kind != "console" && kind != "null")) {
+      throw std::invalid_argument("bad sink " + spec);
+    }
+    return;
+  }
+  throw std::invalid_argument("unknown sink " + kind);
+}
+}
+
+ConfigFile::ConfigFile(const std::string& path, const std::string& section)
+    : keys(),
+      level(LogLevel::INFO),
+      priority_level(LogLevel::ERROR),
+      max_buffer_size(0),
+      flush_interval(0),
+      min_flush_interval(0),
+      queue_budget(0),
+      overflow(LogHandler::Overflow::BLOCK),
+      durability(LogHandler::Durability::NONE),
+      sync_period(0),
+      max_dir_size(0),
+      max_rotated_files(0),
+      sinks() {
+  std::ifstream file(path);
+  if (!file) {
+    throw std::runtime_error("Cannot open config file " + path);
+  }
+
+  std::string line;
+  std::string current_section;
+  bool is_section_sinks = false;  // the section's replace the common ones
+  unsigned line_number = 0;
+  while (std::getline(file, line)) {
+    ++line_number;
+    line = Trim(line.substr(0, line.find('#')));
+    if (line.empty()) continue;
+    if (line.front() == '[' && line.back() == ']') {
+      current_section = Trim(line.substr(1, line.size() - 2));
+      continue;
+    }
+    if (!current_section.empty() && current_section != section) continue;
+
+    const std::size_t equal = line.find('=');
+    const std::string key = Trim(line.substr(0, equal));
+    const std::string value =
+        equal == std::string::npos ? "" : Trim(line.substr(equal + 1));
+    try {
+      if (value.empty()) {
+        throw std::invalid_argument("missing value");
+      } else if (key == "level") {
+        level = ParseLevel(value);
+      } else if (key == "priority_level") {
+        priority_level = ParseLevel(value);
+      } else if (key == "max_buffer_size") {
+        max_buffer_size = std::max<std::uint64_t>(
+            1, std::min<std::uint64_t>(ParseNumber(value), UINT_MAX));
+      } else if (key == "flush_interval_us") {
+        flush_interval = ParseDuration<std::chrono::microseconds>(value);
+      } else if (key == "adaptive_flush_us") {
+        min_flush_interval =
+            ParseDuration<std::chrono::microseconds>(value);
+      } else if (key == "queue_budget") {
+        queue_budget = ParseNumber(value);
+      } else if (key == "overflow") {
+        if (value != "BLOCK" && value != "DROP") {
+          throw std::invalid_argument("unknown overflow " + value);
+        }
+        overflow = value == "BLOCK" ? LogHandler::Overflow::BLOCK
+                                    : LogHandler::Overflow::DROP;
+      } else if (key == "durability") {
+        if (value == "NONE") {
+          durability = LogHandler::Durability::NONE;
+        } else if (value == "PERIODIC") {
+          durability = LogHandler::Durability::PERIODIC;
+        } else if (value == "WARN") {
+          durability = LogHandler::Durability::WARN;
+        } else {
+          throw std::invalid_argument("unknown durability " + value);
+        }
+      } else if (key == "sync_period_ms") {
+        sync_period = ParseDuration<std::chrono::milliseconds>(value);
+      } else if (key == "max_dir_size") {
+        max_dir_size = ParseNumber(value);
+      } else if (key == "max_rotated_files") {
+        max_rotated_files = std::min<std::uint64_t>(ParseNumber(value),
+                                                    UINT_MAX);
+      } else if (key == "sink") {
+        CheckSink(value);
+        if (!current_section.empty() && !is_section_sinks) {
+          sinks.clear();
+          is_section_sinks = true;
+        }
+        sinks.push_back(value);
+      } else {
+        throw std::invalid_argument("unknown key " + key);
+      }
+    } catch (const std::logic_error& error) {
+      // invalid_argument and out_of_range, from std::stoull too
+      throw std::runtime_error(path + ":" + std::to_string(line_number) +
+                               ": " + error.what());
+    }
+    keys.insert(key);
+  }
+}
+
+std::shared_ptr<Sink> MakeSink(const std::string& spec,
+                               std::uint64_t max_dir_size,
+                               unsigned max_rotated_files) {
+  const std::size_t space = spec.find(' ');
+  const std::string kind = spec.substr(0, space);
+  const std::string path =
+      space == std::string::npos ? "" : Trim(spec.substr(space + 1));
+  if (kind == "console") return std::make_shared<ConsoleSink>();
+  if (kind == "file") {
+    auto sink = std::make_shared<FileSink>(path);
+    sink->set_retention(max_dir_size, max_rotated_files);
+    return sink;
+  }
+  if (kind == "binary") return std::make_shared<BinaryFileSink>(path);
+  if (kind == "unix") return std::make_shared<UnixSocketSink>(path);
+  if (kind == "shm") return std::make_shared<ShmRingSink>(path);
+  return std::make_shared<NullSink>();
+}
+
+ConfigWatcher::ConfigWatcher(const std::string& path)
+    : file_name_(), inotify_fd_(-1) {
+  std::string dir;
+  PathToFile(path, dir, file_name_);
+  inotify_fd_ = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+  if (inotify_fd_ < 0 ||
+      inotify_add_watch(inotify_fd_, dir.empty() ? "." : dir.c_str(),
+                        IN_CLOSE_WRITE | IN_MOVED_TO) < 0) {
+    if (inotify_fd_ >= 0) close(inotify_fd_);
+    throw std::runtime_error("Cannot watch config file " + path);
+  }
+}
+
+ConfigWatcher::~ConfigWatcher() {
+  if (inotify_fd_ >= 0) close(inotify_fd_);
+}
+
+bool ConfigWatcher::IsChanged() {
+  // a whole event, the longest name included, fits
+  alignas(inotify_event) char buffer[4096];
+  bool is_changed = false;
+  ssize_t length;
+  while ((length = read(inotify_fd_, buffer, sizeof(buffer))) > 0) {
+    for (ssize_t pos = 0; pos < length;) {
+      const auto* event =
+          reinterpret_cast<const inotify_event*>(buffer + pos);
+      if (event->len > 0 && file_name_ == event->name) {
+        is_changed = true;
+      }
+      pos += sizeof(inotify_event) + event->len;
+    }
+  }
+  return is_changed;
+}
+}
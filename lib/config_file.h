@@ -0,0 +1,79 @@
+#ifndef LOGGING_PLUS_PLUS_CONFIG_FILE_H_
+#define LOGGING_PLUS_PLUS_CONFIG_FILE_H_
+
+#include <chrono>
+#include <memory>
+#include <set>
+#include <string>
+#include <vector>
+#include "../include/log_handler.h"
+
+namespace logger {
+
+/**
+ * Settings of a logger config file: "key = value" lines and '#' comments.
+ * Lines above the first [name] header are read by every handler, lines
+ * below it by the handler of that name only, they override the others.
+ * Keys not in the file are left to the setters.
+ *   level = INFO                     priority_level = ERROR
+ *   max_buffer_size = 50             flush_interval_us = 3000000
+ *   adaptive_flush_us = 100          (minimum interval, 0 turns it off)
+ *   queue_budget = 8388608           overflow = BLOCK | DROP
+ *   durability = NONE | PERIODIC | WARN
+ *   sync_period_ms = 1000
+ *   max_dir_size = 10737418240       max_rotated_files = 20
+ *   sink = console | null | file PATH | binary PATH | unix PATH | shm NAME
+ * Every sink line adds a sink, together they replace the sinks. The file
+ * sinks of the file keep their directory under the quota, see
+ * LogHandler::set_log_retention(). Durations are capped at a day.
+ */
+struct ConfigFile {
+  // throws std::runtime_error naming the file and line
+  ConfigFile(const std::string &path, const std::string &section);
+
+  bool has(const std::string &key) const { return keys.count(key) > 0; }
+
+  std::set<std::string> keys;  // the ones found in the file
+  LogLevel level;
+  LogLevel priority_level;
+  unsigned max_buffer_size;
+  std::chrono::microseconds flush_interval;
+  std::chrono::microseconds min_flush_interval;  // 0: not adaptive
+  std::size_t queue_budget;
+  LogHandler::Overflow overflow;
+  LogHandler::Durability durability;
+  std::chrono::milliseconds sync_period;
+  std::uint64_t max_dir_size;
+  unsigned max_rotated_files;
+  std::vector<std::string> sinks;  // "file app.log", in file order
+};
+
+/**
+ * New sink for a sink line of a config file, not opened yet. A file sink
+ * gets the retention.
+ */
+std::shared_ptr<Sink> MakeSink(const std::string &spec,
+                               std::uint64_t max_dir_size,
+                               unsigned max_rotated_files);
+
+/**
+ * Tells whether a file was written or replaced since the last call,
+ * without blocking. Its directory is watched with inotify, editors save by
+ * renaming a new file over the old one.
+ */
+class ConfigWatcher {
+ public:
+  explicit ConfigWatcher(const std::string &path);
+  ConfigWatcher(const ConfigWatcher &) = delete;
+  ConfigWatcher &operator=(const ConfigWatcher &) = delete;
+  ~ConfigWatcher();
+
+  bool IsChanged();
+
+ private:
+  std::string file_name_;
+  int inotify_fd_;
+};
+}
+
+#endif /* LOGGING_PLUS_PLUS_CONFIG_FILE_H_ */
@@ -0,0 +1,36 @@
+#include <cerrno>
+#include <ctime>
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include "event_count.h"
+
+namespace logger {
+
+static_assert(sizeof(std::atomic<std::uint32_t>) == sizeof(std::uint32_t),
+              "futex word must be a plain 32 bit integer");
+
+bool EventCount::Wait(const std::uint32_t key,
+                      const std::chrono::microseconds& timeout) {
+  struct timespec relative;
+  relative.tv_sec = timeout.count() / 1000000;
+  relative.tv_nsec = timeout.count() % 1000000 * 1000;
+
+  bool is_notified = true;
+  if (epoch_.load(std::memory_order_acquire) == key) {
+    // returns at once with EAGAIN when the epoch moved on meanwhile
+    if (syscall(SYS_futex, reinterpret_cast<std::uint32_t*>(&epoch_),
+                FUTEX_WAIT_PRIVATE, key, &relative, nullptr, 0) < 0 &&
+        errno == ETIMEDOUT) {
+      is_notified = false;
+    }
+  }
+  waiters_.fetch_sub(1, std::memory_order_relaxed);
+  return is_notified;
+}
+
+void EventCount::Wake() {
+  syscall(SYS_futex, reinterpret_cast<std::uint32_t*>(&epoch_),
+          FUTEX_WAKE_PRIVATE, 1, nullptr, nullptr, 0);
+}
+}
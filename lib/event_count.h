@@ -0,0 +1,50 @@
+#ifndef LOGGING_PLUS_PLUS_EVENT_COUNT_H_
+#define LOGGING_PLUS_PLUS_EVENT_COUNT_H_
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+namespace logger {
+
+/**
+ * Wakes up one waiting thread without a mutex. The waiter announces itself
+ * with PrepareWait(), checks its condition once more and then Wait()s,
+ * a Notify() in between makes Wait() return at once. Notify() costs an
+ * atomic load when nobody waits, the futex syscall only when somebody does.
+ */
+class EventCount {
+ public:
+  EventCount() : epoch_(0), waiters_(0) {}
+  EventCount(const EventCount &) = delete;
+  EventCount &operator=(const EventCount &) = delete;
+
+  void Notify() {
+    // pairs with the increment of PrepareWait(): either the waiter sees the
+    // new condition, or the notifier sees the waiter
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (waiters_.load(std::memory_order_relaxed) == 0) return;
+    epoch_.fetch_add(1, std::memory_order_release);
+    Wake();
+  }
+
+  // returns the key to Wait() for
+  std::uint32_t PrepareWait() {
+    waiters_.fetch_add(1, std::memory_order_seq_cst);
+    return epoch_.load(std::memory_order_acquire);
+  }
+  void CancelWait() { waiters_.fetch_sub(1, std::memory_order_relaxed); }
+  // false on timeout, true when notified since PrepareWait() or woken
+  // up spuriously
+  bool Wait(const std::uint32_t key,
+            const std::chrono::microseconds &timeout);
+
+ private:
+  void Wake();
+
+  std::atomic<std::uint32_t> epoch_;  // futex word, bumped by every wake up
+  std::atomic<std::uint32_t> waiters_;
+};
+}
+
+#endif /* LOGGING_PLUS_PLUS_EVENT_COUNT_H_ */
@@ -0,0 +1,209 @@
+#include <algorithm>
+#include <cerrno>
+#include <csignal>
+#include <cstddef>
+#include <mutex>
+#include <fcntl.h>
+#include <unistd.h>
+#include "binary_log.h"
+#include "flight_recorder.h"
+
+namespace logger {
+
+namespace {
+
+const unsigned kMaxRecorders = 16;
+const int kCrashSignals[] = {SIGSEGV, SIGABRT, SIGBUS};
+const std::size_t kCrashSignalCount = sizeof(kCrashSignals) / sizeof(int);
+const std::size_t kAltStackSize = 64 << 10;
+std::atomic<FlightRecorder*> crash_recorders[kMaxRecorders];
+// what the application installed before, restored once dumped
+struct sigaction previous_crash_actions[kCrashSignalCount];
+// a stack overflow leaves no stack for the handler
+char crash_alt_stack[kAltStackSize];
+
+// everything below runs in a signal handler: no allocation, no locks,
+// no stdio, only async-signal-safe syscalls
+
+void WriteAll(int fd, const char* data, std::size_t size) {
+  while (size > 0) {
+    const ssize_t written = write(fd, data, size);
+    if (written < 0 && errno == EINTR) continue;
+    if (written <= 0) return;
+    data += written;
+    size -= written;
+  }
+}
+
+std::size_t PutFixed(std::uint64_t value, std::size_t size, char* out) {
+  for (std::size_t idx = 0; idx < size; ++idx) {
+    out[idx] = static_cast<char>(value >> (idx * 8));
+  }
+  return size;
+}
+
+std::size_t PutString(const char* str, char* out) {
+  std::size_t size = 0;
+  while (str[size] != '\0' && size < 255) ++size;
+  const std::size_t varint_size = EncodeVarint(size, out);
+  std::memcpy(out + varint_size, str, size);
+  return varint_size + size;
+}
+
+/**
+ * One record as a whole block, with its own call site as dictionary
+ */
+std::size_t EncodeBlock(const LogRecord& record, std::uint32_t id,
+                        char* out) {
+  char* dict = out + kBlockHeaderSize;
+  std::size_t dict_size = EncodeVarint(id, dict);
+  dict_size += EncodeVarint(record.line, dict + dict_size);
+  dict_size += PutString(record.file, dict + dict_size);
+  dict_size += PutString(record.func, dict + dict_size);
+
+  char* data = dict + dict_size;
+  std::size_t data_size = EncodeVarint(id, data);
+  data[data_size++] = static_cast<char>(record.level);
+  data_size += EncodeVarint(ZigZagEncode(0), data + data_size);
+  data_size += EncodeVarint(record.args_size, data + data_size);
+  std::memcpy(data + data_size, record.args, record.args_size);
+  data_size += record.args_size;
+
+  PutFixed(kBlockMagic, 4, out);
+  PutFixed(dict_size, 4, out + 4);
+  PutFixed(data_size, 4, out + 8);
+  PutFixed(1, 4, out + 12);
+  PutFixed(static_cast<std::uint64_t>(record.time), 8, out + 16);
+  return kBlockHeaderSize + dict_size + data_size;
+}
+
+void OnCrashSignal(int signal) {
+  for (auto& slot : crash_recorders) {
+    const FlightRecorder* recorder = slot.load();
+    if (recorder != nullptr) {
+      recorder->DumpCrashFile();
+    }
+  }
+  // hand the signal to the previous handler, or the default action: it is
+  // blocked until this handler returns, a fault would happen again anyway
+  for (std::size_t idx = 0; idx < kCrashSignalCount; ++idx) {
+    if (kCrashSignals[idx] == signal) {
+      sigaction(signal, &previous_crash_actions[idx], nullptr);
+    }
+  }
+  raise(signal);
+}
+}
+
+FlightRecorder::FlightRecorder(unsigned capacity,
+                               const std::string& crash_path)
+    : capacity_(capacity),
+      slots_(new Slot[capacity]),
+      next_(0),
+      crash_path_(),
+      is_installed_(false) {
+  for (unsigned idx = 0; idx < capacity_; ++idx) {
+    slots_[idx].seq.store(0, std::memory_order_relaxed);
+  }
+  crash_path.copy(crash_path_, sizeof(crash_path_) - 1);
+}
+
+FlightRecorder::~FlightRecorder() {
+  if (!is_installed_) return;
+  for (auto& slot : crash_recorders) {
+    FlightRecorder* recorder = this;
+    slot.compare_exchange_strong(recorder, nullptr);
+  }
+}
+
+void FlightRecorder::Record(const LogRecord& record) {
+  const std::uint64_t seq = next_.fetch_add(1, std::memory_order_relaxed);
+  Slot& slot = slots_[seq % capacity_];
+  // a writer a lap behind may still copy into the slot, or a lap ahead
+  // be done with it: this record is lost rather than mixed with another
+  std::uint64_t current = slot.seq.load(std::memory_order_relaxed);
+  if ((current & 1) != 0 || current > 2 * seq ||
+      !slot.seq.compare_exchange_strong(current, 2 * seq + 1,
+                                        std::memory_order_acquire,
+                                        std::memory_order_relaxed)) {
+    return;
+  }
+  std::atomic_thread_fence(std::memory_order_release);
+  std::memcpy(&slot.record, &record,
+              offsetof(LogRecord, args) + record.args_size);
+  slot.seq.store(2 * seq + 2, std::memory_order_release);
+}
+
+void FlightRecorder::Dump(int fd) const {
+  char buffer[kBlockHeaderSize + 1024];
+  WriteAll(fd, kSegmentMagic, kSegmentMagicSize);
+  buffer[0] = static_cast<char>(kBinaryVersion);
+  WriteAll(fd, buffer, 1);
+
+  const std::uint64_t end = next_.load(std::memory_order_acquire);
+  const std::uint64_t begin = end > capacity_ ? end - capacity_ : 0;
+  std::uint32_t id = 0;
+  LogRecord record;
+  for (std::uint64_t seq = begin; seq < end; ++seq) {
+    const Slot& slot = slots_[seq % capacity_];
+    // skip records being written, or overwritten since
+    if (slot.seq.load(std::memory_order_acquire) != 2 * seq + 2) continue;
+    std::memcpy(&record, &slot.record, offsetof(LogRecord, args));
+    record.args_size =
+        std::min<std::uint16_t>(record.args_size, kMaxArgsSize);
+    std::memcpy(record.args, slot.record.args, record.args_size);
+    // and records overwritten while copied
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (slot.seq.load(std::memory_order_relaxed) != 2 * seq + 2) continue;
+    WriteAll(fd, buffer, EncodeBlock(record, id++, buffer));
+  }
+}
+
+void FlightRecorder::DumpCrashFile() const {
+  const int fd = open(crash_path_, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if (fd < 0) return;
+  Dump(fd);
+  close(fd);
+}
+
+void FlightRecorder::InstallCrashHandler() {
+  static std::mutex install_mtx;
+  std::lock_guard<std::mutex> lock(install_mtx);
+  if (is_installed_) return;
+
+  for (auto& slot : crash_recorders) {
+    FlightRecorder* empty = nullptr;
+    if (slot.compare_exchange_strong(empty, this)) {
+      is_installed_ = true;
+      break;
+    }
+  }
+  if (!is_installed_) return;
+
+  // the first recorder installs the handler for every other one
+  static bool is_handler_installed = false;
+  if (is_handler_installed) return;
+  is_handler_installed = true;
+
+  // the installing thread runs the handler on its own stack, other
+  // threads on theirs if they set one up
+  stack_t old_stack;
+  if (sigaltstack(nullptr, &old_stack) == 0 &&
+      (old_stack.ss_flags & SS_DISABLE) != 0) {
+    stack_t alt_stack;
+    std::memset(&alt_stack, 0, sizeof(alt_stack));
+    alt_stack.ss_sp = crash_alt_stack;
+    alt_stack.ss_size = sizeof(crash_alt_stack);
+    sigaltstack(&alt_stack, nullptr);
+  }
+
+  struct sigaction action;
+  std::memset(&action, 0, sizeof(action));
+  action.sa_handler = OnCrashSignal;
+  action.sa_flags = SA_ONSTACK;
+  sigemptyset(&action.sa_mask);
+  for (std::size_t idx = 0; idx < kCrashSignalCount; ++idx) {
+    sigaction(kCrashSignals[idx], &action, &previous_crash_actions[idx]);
+  }
+}
+}
@@ -0,0 +1,46 @@
+#ifndef LOGGING_PLUS_PLUS_FLIGHT_RECORDER_H_
+#define LOGGING_PLUS_PLUS_FLIGHT_RECORDER_H_
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include "../include/log_record.h"
+
+namespace logger {
+
+/**
+ * Keeps the most recent records in memory, whatever happened to the queue.
+ * Recording is lock-free and costs one copy of the record. On SIGSEGV,
+ * SIGABRT or SIGBUS the ring is dumped as a binary log (see binary_log.h)
+ * to the crash file, read it with logpp-decode.
+ */
+class FlightRecorder {
+ public:
+  FlightRecorder(unsigned capacity, const std::string &crash_path);
+  FlightRecorder(const FlightRecorder &) = delete;
+  FlightRecorder &operator=(const FlightRecorder &) = delete;
+  ~FlightRecorder();
+
+  void Record(const LogRecord &record);
+  // async-signal-safe, write the oldest to newest complete records
+  void Dump(int fd) const;
+  void DumpCrashFile() const;
+
+  // dump into the crash file on fatal signals, until destroyed
+  void InstallCrashHandler();
+
+ private:
+  struct Slot {
+    std::atomic<std::uint64_t> seq;  // 2n + 2 once record n is complete
+    LogRecord record;
+  };
+
+  const unsigned capacity_;
+  std::unique_ptr<Slot[]> slots_;
+  std::atomic<std::uint64_t> next_;
+  char crash_path_[256];
+  bool is_installed_;
+};
+}
+
+#endif /* LOGGING_PLUS_PLUS_FLIGHT_RECORDER_H_ */
@@ -0,0 +1,94 @@
+#include <algorithm>
+#include <vector>
+#include "latency_histogram.h"
+
+namespace logger {
+
+namespace {
+
+const unsigned kSubBucketBits = 4;
+const unsigned kSubBuckets = 1 << kSubBucketBits;
+const unsigned kMaxBits = 40;  // larger values land in the last bucket
+const unsigned kBuckets = (kMaxBits - kSubBucketBits + 1) * kSubBuckets;
+
+unsigned BucketIndex(std::uint64_t value) {
+  if (value < kSubBuckets) return static_cast<unsigned>(value);
+  value = std::min<std::uint64_t>(value, (1ull << kMaxBits) - 1);
+  const unsigned bits = 63 - __builtin_clzll(value);  // highest bit set
+  const unsigned shift = bits - kSubBucketBits;
+  return (shift + 1) * kSubBuckets +
+         static_cast<unsigned>((value >> shift) & (kSubBuckets - 1));
+}
+
+/**
+ * Highest value of a bucket, percentiles don't look better than they are
+ */
+std::uint64_t BucketValue(unsigned index) {
+  if (index < kSubBuckets) return index;
+  const unsigned shift = index / kSubBuckets - 1;
+  const std::uint64_t low =
+      static_cast<std::uint64_t>(kSubBuckets + index % kSubBuckets) << shift;
+  return low + (1ull << shift) - 1;
+}
+}
+
+struct LatencyHistogram::Shard {
+  std::atomic<std::uint64_t> counts[kBuckets];
+  std::atomic<std::uint64_t> max;
+};
+
+LatencyHistogram::LatencyHistogram(unsigned shard_count)
+    : shard_count_(shard_count), shards_(new Shard[shard_count]) {
+  for (unsigned shard = 0; shard < shard_count_; ++shard) {
+    for (auto& count : shards_[shard].counts) {
+      count.store(0, std::memory_order_relaxed);
+    }
+    shards_[shard].max.store(0, std::memory_order_relaxed);
+  }
+}
+
+LatencyHistogram::~LatencyHistogram() {}
+
+void LatencyHistogram::Record(unsigned shard, std::uint64_t nanoseconds) {
+  Shard& target = shards_[shard % shard_count_];
+  target.counts[BucketIndex(nanoseconds)].fetch_add(
+      1, std::memory_order_relaxed);
+  std::uint64_t max = target.max.load(std::memory_order_relaxed);
+  while (nanoseconds > max &&
+         !target.max.compare_exchange_weak(max, nanoseconds,
+                                           std::memory_order_relaxed)) {
+  }
+}
+
+LatencyHistogram::Summary LatencyHistogram::Summarize() const {
+  Summary summary = {0, 0, 0, 0, 0};
+  std::vector<std::uint64_t> counts(kBuckets, 0);
+  for (unsigned shard = 0; shard < shard_count_; ++shard) {
+    for (unsigned idx = 0; idx < kBuckets; ++idx) {
+      counts[idx] += shards_[shard].counts[idx].load(std::memory_order_relaxed);
+    }
+    summary.max = std::max(
+        summary.max, shards_[shard].max.load(std::memory_order_relaxed));
+  }
+  for (const auto count : counts) {
+    summary.count += count;
+  }
+  if (summary.count == 0) return summary;
+
+  // the value below which the given share of the samples lies
+  auto percentile = [&counts, &summary](double share) {
+    const std::uint64_t rank =
+        std::max<std::uint64_t>(1, share * summary.count + 0.5);
+    std::uint64_t seen = 0;
+    for (unsigned idx = 0; idx < kBuckets; ++idx) {
+      seen += counts[idx];
+      if (seen >= rank) return std::min(BucketValue(idx), summary.max);
+    }
+    return summary.max;
+  };
+  summary.p50 = percentile(0.5);
+  summary.p99 = percentile(0.99);
+  summary.p999 = percentile(0.999);
+  return summary;
+}
+}
@@ -0,0 +1,42 @@
+#ifndef LOGGING_PLUS_PLUS_LATENCY_HISTOGRAM_H_
+#define LOGGING_PLUS_PLUS_LATENCY_HISTOGRAM_H_
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+
+namespace logger {
+
+/**
+ * Log-linear histogram of durations in nanoseconds, as HdrHistogram does
+ * it: every power of two is split into 16 linear buckets, which keeps the
+ * error under 6.25% from 1ns to about 18 minutes. Every shard is written
+ * by its own threads with relaxed atomics, Percentile() merges them.
+ */
+class LatencyHistogram {
+ public:
+  explicit LatencyHistogram(unsigned shard_count);
+  LatencyHistogram(const LatencyHistogram &) = delete;
+  LatencyHistogram &operator=(const LatencyHistogram &) = delete;
+  ~LatencyHistogram();
+
+  void Record(unsigned shard, std::uint64_t nanoseconds);
+
+  struct Summary {
+    std::uint64_t count;
+    std::uint64_t p50;
+    std::uint64_t p99;
+    std::uint64_t p999;
+    std::uint64_t max;  // exact
+  };
+  Summary Summarize() const;
+
+ private:
+  struct Shard;
+
+  const unsigned shard_count_;
+  std::unique_ptr<Shard[]> shards_;
+};
+}
+
+#endif /* LOGGING_PLUS_PLUS_LATENCY_HISTOGRAM_H_ */
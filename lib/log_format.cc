@@ -0,0 +1,112 @@
+#include <cstdio>
+#include <ctime>
+#include "log_format.h"
+
+namespace logger {
+
+bool FormatArgs(const char* args, std::size_t args_size, char* out,
+                std::size_t out_size) {
+  const char* pos = args;
+  const char* end = args + args_size;
+  std::size_t used = 0;
+  out[0] = '\0';
+  while (pos < end) {
+    const char type = *pos++;
+    std::uint64_t value;
+    int written = 0;
+    switch (type) {
+      case kArgSigned:
+        if (!DecodeVarint(pos, end, value)) return false;
+        written = snprintf(out + used, out_size - used, "%lld",
+                           static_cast<long long>(ZigZagDecode(value)));
+        break;
+      case kArgUnsigned:
+        if (!DecodeVarint(pos, end, value)) return false;
+        written = snprintf(out + used, out_size - used, "%llu",
+                           static_cast<unsigned long long>(value));
+        break;
+      case kArgDouble: {
+        if (end - pos < 8) return false;
+        std::uint64_t bits = 0;
+        for (unsigned idx = 0; idx < 8; ++idx) {
+          bits |= static_cast<std::uint64_t>(
+                      static_cast<unsigned char>(*pos++)) << (idx * 8);
+        }
+        double number;
+        std::memcpy(&number, &bits, sizeof(number));
+        written = snprintf(out + used, out_size - used, "%f", number);
+        break;
+      }
+      case kArgString:
+        if (!DecodeVarint(pos, end, value) ||
+            value > static_cast<std::uint64_t>(end - pos)) {
+          return false;
+        }
+        written = snprintf(out + used, out_size - used, "%.*s",
+                           static_cast<int>(value), pos);
+        pos += value;
+        break;
+      default:
+        return false;
+    }
+    if (written < 0) return false;
+    used += written;
+    if (used >= out_size) break;  // truncated, like the line itself
+  }
+  return true;
+}
+
+LogFormatter::LogFormatter() : time_second_(-1), time_str_() {}
+
+void LogFormatter::FreshTime(std::int64_t second) {
+  std::time_t now = static_cast<std::time_t>(second);
+  char buffer[32];
+  if (ctime_r(&now, buffer) == nullptr) {
+    buffer[0] = '\0';
+  }
+  std::size_t size = std::strlen(buffer);
+  if (size > 0 && buffer[size - 1] == '\n') buffer[size - 1] = '\0';
+  std::memcpy(time_str_, buffer, sizeof(time_str_));
+  time_second_ = second;
+}
+
+void LogFormatter::Format(const LogRecord& record, bool with_color,
+                          std::string& out) {
+  const std::int64_t second = record.time / 1000000;
+  if (second != time_second_) {
+    FreshTime(second);
+  }
+
+  if (with_color) {
+    switch (record.level) {
+      case LogLevel::TRACE:
+        out += "\x1b[35m";  // magenta
+        break;
+      case LogLevel::DEBUG:
+        out += "\x1b[34m";  // blue
+        break;
+      case LogLevel::INFO:
+        out += "\x1b[32m";  // green
+        break;
+      case LogLevel::WARN:
+        out += "\x1b[33m";  // yellow
+        break;
+      case LogLevel::ERROR:
+        out += "\x1b[31m";  // red
+        break;
+    }
+  }
+
+  char msg[kMaxMsgSize];
+  FormatArgs(record.args, record.args_size, msg, sizeof(msg));
+  char buffer[kMaxMsgSize];
+  int size = snprintf(buffer, sizeof(buffer), "%s -> [%s::%s::%u] %s >> %s\n",
+                      GetLogLevel(record.level).c_str(), record.file,
+                      record.func, record.line, time_str_, msg);
+  if (size < 0) return;
+  if (static_cast<std::size_t>(size) >= sizeof(buffer)) {
+    size = sizeof(buffer) - 1;
+  }
+  out.append(buffer, size);
+}
+}
@@ -0,0 +1,34 @@
+#ifndef LOGGING_PLUS_PLUS_LOG_FORMAT_H_
+#define LOGGING_PLUS_PLUS_LOG_FORMAT_H_
+
+#include <string>
+#include "../include/log_record.h"
+
+namespace logger {
+
+/**
+ * Render encoded arguments as text, return false if they are malformed
+ */
+bool FormatArgs(const char *args, std::size_t args_size, char *out,
+                std::size_t out_size);
+
+/**
+ * Turn records into today's text lines:
+ *   LEVEL -> [file::func::line] Www Mmm dd hh:mm:ss yyyy >> msg
+ */
+class LogFormatter {
+ public:
+  LogFormatter();
+
+  // append the formatted record to out, prefixed by its color if asked
+  void Format(const LogRecord &record, bool with_color, std::string &out);
+
+ private:
+  void FreshTime(std::int64_t second);
+
+  std::int64_t time_second_;  // second of the cached time string
+  char time_str_[32];
+};
+}
+
+#endif /* LOGGING_PLUS_PLUS_LOG_FORMAT_H_ */
@@ -1,97 +1,537 @@
-#include <iostream>
-#include <ctime>
+#include <algorithm>
+#include <atomic>
 #include <chrono>
-#include <unistd.h>
-#include <sys/stat.h>
+#include <csignal>
+#include <cstddef>
+#include <cstring>
+#include <iostream>
 #include "../include/log_handler.h"
-#include "helper.h"
+#include "config_file.h"
+#include "event_count.h"
+#include "flight_recorder.h"
+#include "latency_histogram.h"
 
 namespace logger {
 
-LogHandler::LogHandler()
-    : kMaxMsgSize(300),
+namespace {
+
+const unsigned kCounterShards = 16;
+// early_next_ from Init() on, far beyond any early buffer
+const unsigned kEarlyClosed = 1u << 31;
+const std::chrono::seconds kShutdownTimeout(5);  // of the destructor
+// least time between two looks for config file changes, while busy
+const std::chrono::milliseconds kConfigCheckPeriod(100);
+// between fsyncs while a sink fails them, doubling
+const std::chrono::milliseconds kMinSyncRetryBackoff(100);
+const std::chrono::milliseconds kMaxSyncRetryBackoff(5000);
+
+template <typename SinkType>
+void EraseSinks(std::vector<std::shared_ptr<Sink>>& sinks) {
+  sinks.erase(std::remove_if(sinks.begin(), sinks.end(),
+                             [](const std::shared_ptr<Sink>& sink) {
+                               return dynamic_cast<SinkType*>(sink.get()) !=
+                                      nullptr;
+                             }),
+              sinks.end());
+}
+
+std::atomic<unsigned> hangup_count(0);  // SIGHUPs so far
+struct sigaction previous_hangup_action;
+
+void OnHangup(int signal) {
+  hangup_count.fetch_add(1, std::memory_order_relaxed);
+  const auto& previous = previous_hangup_action;
+  if (!(previous.sa_flags & SA_SIGINFO) && previous.sa_handler != SIG_DFL &&
+      previous.sa_handler != SIG_IGN) {
+    previous.sa_handler(signal);
+  }
+}
+
+/**
+ * Count SIGHUPs for every handler, once per process. A handler installed
+ * before is still called.
+ */
+void InstallHangupHandler() {
+  static const bool is_installed = [] {
+    struct sigaction action;
+    std::memset(&action, 0, sizeof(action));
+    action.sa_handler = OnHangup;
+    action.sa_flags = SA_RESTART;
+    sigemptyset(&action.sa_mask);
+    return sigaction(SIGHUP, &action, &previous_hangup_action) == 0;
+  }();
+  (void)is_installed;
+}
+
+/**
+ * Reopen a sink's file, a failure leaves it writing to the old one
+ */
+void ReopenSink(Sink& sink) {
+  try {
+    sink.Reopen();
+  } catch (const std::exception& error) {
+    std::cerr << "logpp: sink not reopened: " << error.what() << std::endl;
+  }
+}
+
+/**
+ * Threads spread over the shards in the order they first log
+ */
+unsigned ThreadShard() {
+  static std::atomic<unsigned> next_shard(0);
+  thread_local const unsigned shard =
+      next_shard.fetch_add(1, std::memory_order_relaxed) % kCounterShards;
+  return shard;
+}
+
+/**
+ * Bytes a record takes in the queue, the unused args bytes are left out
+ */
+std::size_t PackedSize(const LogRecord& record) {
+  return offsetof(LogRecord, args) + record.args_size;
+}
+
+/**
+ * Unpack up to max_count records from pos on, returns where they end
+ */
+std::size_t UnpackRecords(const std::string& packed, std::size_t pos,
+                          std::size_t max_count, std::vector<LogRecord>& out) {
+  for (; pos < packed.size() && max_count > 0; --max_count) {
+    out.emplace_back();
+    LogRecord& record = out.back();
+    std::memcpy(&record, packed.data() + pos, offsetof(LogRecord, args));
+    pos += offsetof(LogRecord, args);
+    std::memcpy(record.args, packed.data() + pos, record.args_size);
+    pos += record.args_size;
+  }
+  return pos;
+}
+
+std::size_t CountRecords(const std::string& packed, std::size_t pos) {
+  std::size_t count = 0;
+  for (; pos < packed.size(); ++count) {
+    LogRecord header;
+    std::memcpy(&header, packed.data() + pos, offsetof(LogRecord, args));
+    pos += PackedSize(header);
+  }
+  return count;
+}
+}
+
+/**
+ * Everything a setter may change while running. Never modified once
+ * published, setters publish a modified copy instead.
+ */
+struct LogHandler::Config {
+  Config()
+      : sinks({std::make_shared<ConsoleSink>(),
+               std::make_shared<FileSink>("app.log")}),
+        log_level(LogLevel::INFO),
+        priority_level(LogLevel::ERROR),
+        max_buffer_size(50),
+        queue_budget(0),
+        overflow(Overflow::BLOCK),
+        flush_interval(std::chrono::seconds(3)),
+        is_adaptive_flush(false),
+        min_flush_interval(100),
+        durability(Durability::NONE),
+        sync_period(1000) {}
+
+  std::vector<std::shared_ptr<Sink>> sinks;  // output destinations
+  LogLevel log_level;                        // limit log level
+  LogLevel priority_level;    // lowest level that is written at once
+  unsigned max_buffer_size;   // records of a full batch
+  std::size_t queue_budget;   // max queued_bytes_, 0 for no limit
+  Overflow overflow;
+  std::chrono::microseconds flush_interval;  // longest wait for a batch
+  bool is_adaptive_flush;
+  std::chrono::microseconds min_flush_interval;
+  Durability durability;
+  std::chrono::milliseconds sync_period;
+};
+
+struct LogHandler::CounterShard {
+  std::atomic<std::uint64_t> enqueued;
+  std::atomic<std::uint64_t> dropped;
+  char padding[64 - 2 * sizeof(std::atomic<std::uint64_t>)];  // cache line
+};
+
+struct LogHandler::EarlySlot {
+  EarlySlot() : is_ready(false) {}
+  std::atomic<bool> is_ready;
+  LogRecord record;
+};
+
+LogHandler::LogHandler(const std::string& name)
+    : log_event_(new EventCount()),
       is_output_ready_(false),
       is_close_output_(false),
       is_stop_(true),
+      is_closed_(false),
+      is_abort_output_(false),
+      is_output_done_(false),
+      lost_records_(0),
       output_thread_(),
-      max_buffer_size_(50),
-      flush_frequency_(3),
-      log_dir_(""),
-      log_file_("app.log"),
+      name_(name),
+      config_(new Config()),
+      retired_configs_(),
+      last_sync_time_(),
+      sync_retry_time_(),
+      sync_retry_backoff_(kMinSyncRetryBackoff),
       log_level_(LogLevel::INFO),
-      output_({{Output::FILE, true}, {Output::CONSOLE, true}}),
+      min_level_(LogLevel::INFO),
+      log_path_("app.log"),
+      max_dir_size_(0),
+      max_rotated_files_(0),
+      flight_recorder_size_(1024),
+      flight_recorder_level_(LogLevel::ERROR),
+      crash_dump_file_(),
+      flight_recorder_(),
+      latency_histogram_(),
+      config_file_(),
+      is_reopen_on_sighup_(false),
+      config_watcher_(),
+      next_config_check_(),
+      file_sinks_(),
+      queued_seq_(0),
+      written_seq_(0),
+      synced_seq_(0),
+      sync_requested_seq_(0),
+      flushed_seq_(0),
+      flush_barriers_(),
+      counter_shards_(new CounterShard[kCounterShards]),
+      early_buffer_size_(256),
+      early_next_(0),
+      early_slots_(nullptr),
+      stats_(),
+      queued_bytes_(0),
       log_read_buffer_(),
-      log_write_buffer_() {}
+      log_write_buffer_(),
+      log_read_count_(0),
+      log_priority_count_(0),
+      batch_() {
+  for (unsigned idx = 0; idx < kCounterShards; ++idx) {
+    counter_shards_[idx].enqueued.store(0, std::memory_order_relaxed);
+    counter_shards_[idx].dropped.store(0, std::memory_order_relaxed);
+  }
+}
 
 LogHandler::~LogHandler() {
-  std::unique_lock<std::mutex> output_lock(output_mtx_);
+  Shutdown(kShutdownTimeout);
+  delete[] early_slots_.load();
+  for (const Config* retired : retired_configs_) {
+    delete retired;
+  }
+  delete config_;
+}
 
-  while (!is_output_ready_) {
-    output_cv_.wait(output_lock);
+/**
+ * Drain within the timeout, then let the output thread close the sinks
+ * and end. A sink busy with a write finishes that batch first.
+ */
+std::uint64_t LogHandler::Shutdown(const std::chrono::milliseconds& timeout) {
+  if (!output_thread_.joinable()) return 0;  // never inited, or shut down
+
+  const auto deadline = std::chrono::steady_clock::now() + timeout;
+  {
+    std::unique_lock<std::mutex> output_lock(output_mtx_);
+    while (!is_output_ready_) {
+      output_cv_.wait(output_lock);
+    }
+  }
+  {
+    std::unique_lock<std::mutex> log_lock(log_mtx_);
+    is_closed_ = true;
+    is_close_output_ = true;
+    space_cv_.notify_all();  // blocked producers drop their records
+    log_event_->Notify();
+    while (!is_output_done_) {
+      if (sync_cv_.wait_until(log_lock, deadline) ==
+              std::cv_status::timeout &&
+          !is_output_done_) {
+        is_abort_output_ = true;
+        log_event_->Notify();
+        while (!is_output_done_) {
+          sync_cv_.wait(log_lock);
+        }
+      }
+    }
   }
-  is_close_output_ = true;
 
   output_thread_.join();
+  return lost_records_;
+}
 
-  if (log_stream_.is_open()) {
-    log_stream_.close();
+/**
+ * Named handlers live until exit, so references to them stay valid
+ */
+LogHandler& LogHandler::GetHandler(const std::string& name) {
+  static std::mutex registry_mtx;
+  static std::map<std::string, std::unique_ptr<LogHandler>> registry;
+
+  std::lock_guard<std::mutex> lock(registry_mtx);
+  auto& handler = registry[name];
+  if (!handler) {
+    handler.reset(new LogHandler(name));
   }
+  return *handler;
 }
 
-struct LogHandler::OutputEntity {
-  std::string color;
-  std::string logMsg;
-};
-
 /**
  * Before using a logger, you need to initialize it.
- * it will open a file Stream if it is allowed to write to a log file
+ * it will open every sink, e.g. file streams
  */
 void LogHandler::Init() {
+  if (!config_file_.empty()) {
+    LoadConfigFile(false);
+    config_watcher_.reset(new ConfigWatcher(config_file_));
+  }
+  if (is_reopen_on_sighup_) {
+    InstallHangupHandler();
+  }
   output_thread_ = std::thread(&LogHandler::StartOutputThread, this);
 
   std::lock_guard<std::mutex> log_lock(log_mtx_);
-  is_stop_ = false;
-  FreshCurrentTime();  // fresh time before logging
+  // nothing could dump the recorder without a crash file, don't pay for it
+  if (flight_recorder_size_ > 0 && !crash_dump_file_.empty()) {
+    flight_recorder_.reset(
+        new FlightRecorder(flight_recorder_size_, crash_dump_file_));
+    flight_recorder_->InstallCrashHandler();
+    min_level_ = std::min(config_->log_level, flight_recorder_level_);
+  }
+  // room for a full batch of the largest records up front, logging then
+  // doesn't allocate unless the output thread falls behind
+  const std::size_t lane_size = config_->max_buffer_size * sizeof(LogRecord);
+  log_read_buffer_.reserve(lane_size);
+  log_write_buffer_.reserve(lane_size);
+  batch_.reserve(config_->max_buffer_size);
+  QueueEarlyRecords();
+  // producers seeing it see the flight recorder and the reserved lanes too
+  is_stop_.store(false, std::memory_order_release);
 
-  if (output_.at(Output::FILE)) {
-    OpenLogStream();
+  for (const auto& sink : config_->sinks) {
+    sink->Open();
   }
+  log_event_->Notify();  // early records may make a batch
 }
 
 /**
- * Setting output filter
+ * Publish a modified copy of the config, called with log_mtx_ held. The
+ * output thread may still read the old one, it frees it once it is back
+ * for its next batch.
  */
-void LogHandler::set_output(const Output& output, bool is_allowed) {
-  std::lock_guard<std::mutex> lck(log_mtx_);
-  if (!is_stop_) return;  // unable to modify when running
-  switch (output) {
-    case Output::FILE:
-      if (!is_allowed && log_stream_.is_open()) {
-        log_stream_.close();
-      }
-      this->output_.at(Output::FILE) = is_allowed;
-      break;
-    case Output::CONSOLE:
-      this->output_.at(Output::CONSOLE) = is_allowed;
-      break;
+template <typename Modify>
+void LogHandler::Reconfigure(Modify modify) {
+  std::unique_ptr<Config> next(new Config(*config_));
+  modify(*next);
+  retired_configs_.push_back(config_);
+  config_ = next.release();
+
+  log_level_.store(config_->log_level, std::memory_order_relaxed);
+  min_level_.store(flight_recorder_ ? std::min(config_->log_level,
+                                               flight_recorder_level_)
+                                    : config_->log_level,
+                   std::memory_order_relaxed);
+  space_cv_.notify_all();  // a larger budget lets blocked producers in
+  log_event_->Notify();
+}
+
+/**
+ * Apply the config file on top of the current settings, throws
+ * std::runtime_error if it can't be read. An unchanged sink line keeps its
+ * sink and open file, new sinks are opened when running.
+ */
+void LogHandler::LoadConfigFile(const bool is_running) {
+  const ConfigFile file(config_file_, name_);
+  std::uint64_t max_dir_size = file.max_dir_size;
+  unsigned max_rotated_files = file.max_rotated_files;
+  {
+    std::lock_guard<std::mutex> lock(log_mtx_);
+    if (!file.has("max_dir_size")) max_dir_size = max_dir_size_;
+    if (!file.has("max_rotated_files")) {
+      max_rotated_files = max_rotated_files_;
+    }
   }
+
+  std::map<std::string, std::shared_ptr<Sink>> file_sinks;
+  std::vector<std::shared_ptr<Sink>> sinks;
+  for (const auto& spec : file.sinks) {
+    auto& sink = file_sinks[spec];
+    if (sink) continue;  // listed twice
+    const auto found = file_sinks_.find(spec);
+    if (found != file_sinks_.end()) {
+      sink = found->second;
+    } else {
+      sink = MakeSink(spec, max_dir_size, max_rotated_files);
+      if (is_running) sink->Open();
+    }
+    sinks.push_back(sink);
+  }
+
+  std::lock_guard<std::mutex> lock(log_mtx_);
+  max_dir_size_ = max_dir_size;
+  max_rotated_files_ = max_rotated_files;
+  Reconfigure([&file, &sinks](Config& config) {
+    if (file.has("level")) config.log_level = file.level;
+    if (file.has("priority_level")) {
+      config.priority_level = file.priority_level;
+    }
+    if (file.has("max_buffer_size")) {
+      config.max_buffer_size = file.max_buffer_size;
+    }
+    if (file.has("flush_interval_us")) {
+      config.flush_interval = file.flush_interval;
+    }
+    if (file.has("adaptive_flush_us")) {
+      config.is_adaptive_flush = file.min_flush_interval.count() > 0;
+      config.min_flush_interval = file.min_flush_interval;
+    }
+    if (file.has("queue_budget")) config.queue_budget = file.queue_budget;
+    if (file.has("overflow")) config.overflow = file.overflow;
+    if (file.has("durability")) config.durability = file.durability;
+    if (file.has("sync_period_ms")) config.sync_period = file.sync_period;
+    if (file.has("sink")) config.sinks = sinks;
+  });
+  file_sinks_.swap(file_sinks);
 }
 
 /**
- * Setting log file and path, and it will set isWriteToFile to true
+ * Reload the config file if it changed, called by the output thread without
+ * log_mtx_. A broken file leaves the settings as they are.
  */
-void LogHandler::set_log_file(const std::string& log_path) {
+void LogHandler::CheckConfigFile() {
+  if (!config_watcher_) return;
+  const auto now = std::chrono::steady_clock::now();
+  if (now < next_config_check_) return;
+  next_config_check_ = now + kConfigCheckPeriod;
+  if (!config_watcher_->IsChanged()) return;
+
+  try {
+    LoadConfigFile(true);
+  } catch (const std::exception& error) {
+    std::cerr << "logpp: config file not reloaded: " << error.what()
+              << std::endl;
+  }
+}
+
+/**
+ * Adding an output destination, opened right away when running
+ */
+void LogHandler::AddSink(const std::shared_ptr<Sink>& sink) {
+  bool is_running;
+  {
+    std::lock_guard<std::mutex> lock(log_mtx_);
+    is_running = !is_stop_ && !is_output_done_;
+  }
+  // opening may take long, e.g. to connect: producers don't wait for it
+  if (is_running) sink->Open();
+
   std::lock_guard<std::mutex> lock(log_mtx_);
-  if (!is_stop_) return;
+  Reconfigure([&sink](Config& config) { config.sinks.push_back(sink); });
+}
+
+/**
+ * Removing an output destination, the output thread closes it before
+ * writing the next batch
+ */
+void LogHandler::RemoveSink(const std::shared_ptr<Sink>& sink) {
+  std::lock_guard<std::mutex> lock(log_mtx_);
+
+  Reconfigure([&sink](Config& config) {
+    config.sinks.erase(
+        std::remove(config.sinks.begin(), config.sinks.end(), sink),
+        config.sinks.end());
+  });
+}
+
+/**
+ * Removing every output destination, including the default ones
+ */
+void LogHandler::ClearSinks() {
+  std::lock_guard<std::mutex> lock(log_mtx_);
+
+  Reconfigure([](Config& config) { config.sinks.clear(); });
+}
+
+/**
+ * Replacing every sink of a type by sink, or removing them if it is null.
+ * The new one is opened right away when running, the output thread closes
+ * the old ones.
+ */
+template <typename SinkType>
+void LogHandler::ReplaceSinks(const std::shared_ptr<Sink>& sink) {
+  bool is_running;
+  {
+    std::lock_guard<std::mutex> lock(log_mtx_);
+    is_running = !is_stop_ && !is_output_done_;
+  }
+  if (sink && is_running) sink->Open();
+
+  std::lock_guard<std::mutex> lock(log_mtx_);
+  Reconfigure([&sink](Config& config) {
+    EraseSinks<SinkType>(config.sinks);
+    if (sink) config.sinks.push_back(sink);
+  });
+}
+
+/**
+ * Turning console or file output on and off
+ */
+void LogHandler::set_output(const Output& output, const bool is_allowed) {
+  if (output == Output::CONSOLE) {
+    ReplaceSinks<ConsoleSink>(is_allowed ? std::make_shared<ConsoleSink>()
+                                         : nullptr);
+    return;
+  }
+  std::shared_ptr<Sink> sink;
+  if (is_allowed) {
+    std::lock_guard<std::mutex> lock(log_mtx_);
+    sink = MakeFileSink();
+  }
+  ReplaceSinks<FileSink>(sink);
+}
 
-  if (log_stream_.is_open()) {
-    log_stream_.close();
+/**
+ * Setting log file and path, and it will turn file output on
+ */
+void LogHandler::set_log_file(const std::string& log_path) {
+  std::shared_ptr<Sink> sink;
+  {
+    std::lock_guard<std::mutex> lock(log_mtx_);
+    log_path_ = log_path;
+    sink = MakeFileSink();
   }
+  ReplaceSinks<FileSink>(sink);
+}
 
-  output_.at(Output::FILE) = true;
+/**
+ * Setting the quota of the log directory, file output restarts with it if
+ * it is on
+ */
+void LogHandler::set_log_retention(const std::uint64_t max_dir_size,
+                                   const unsigned max_rotated_files) {
+  std::shared_ptr<Sink> sink;
+  {
+    std::lock_guard<std::mutex> lock(log_mtx_);
+    max_dir_size_ = max_dir_size;
+    max_rotated_files_ = max_rotated_files;
+    for (const auto& current : config_->sinks) {
+      if (dynamic_cast<FileSink*>(current.get()) != nullptr) {
+        sink = MakeFileSink();
+        break;
+      }
+    }
+  }
+  if (sink) ReplaceSinks<FileSink>(sink);
+}
 
-  PathToFile(log_path, log_dir_, log_file_);
+/**
+ * FileSink of log_path_ with the retention set, called with log_mtx_ held
+ */
+std::shared_ptr<Sink> LogHandler::MakeFileSink() const {
+  auto sink = std::make_shared<FileSink>(log_path_);
+  sink->set_retention(max_dir_size_, max_rotated_files_);
+  return sink;
 }
 
 /**
@@ -99,103 +539,427 @@ void LogHandler::set_log_file(const std::string& log_path) {
  */
 void LogHandler::set_log_level(const LogLevel& level) {
   std::lock_guard<std::mutex> lock(log_mtx_);
-  if (!is_stop_) return;
 
-  log_level_ = level;
+  Reconfigure([&level](Config& config) { config.log_level = level; });
 }
 
 void LogHandler::set_flush_frequency(const unsigned fre) {
-  // FIXME more precisely
+  set_flush_interval(std::chrono::seconds(fre));
+}
+
+void LogHandler::set_flush_interval(
+    const std::chrono::microseconds& interval) {
   std::lock_guard<std::mutex> lock(log_mtx_);
-  if (!is_stop_) return;
 
-  flush_frequency_ = std::chrono::seconds(fre);
+  Reconfigure(
+      [&interval](Config& config) { config.flush_interval = interval; });
+}
+
+void LogHandler::set_adaptive_flush(
+    const bool is_adaptive, const std::chrono::microseconds& min_interval) {
+  std::lock_guard<std::mutex> lock(log_mtx_);
+
+  Reconfigure([is_adaptive, &min_interval](Config& config) {
+    config.is_adaptive_flush = is_adaptive;
+    config.min_flush_interval = min_interval;
+  });
 }
 
 void LogHandler::set_max_buffer_size(const unsigned size) {
   std::lock_guard<std::mutex> lock(log_mtx_);
+
+  Reconfigure([size](Config& config) { config.max_buffer_size = size; });
+}
+
+/**
+ * Setting the memory the queue may take, and what Log() does beyond it
+ */
+void LogHandler::set_queue_budget(const std::size_t bytes,
+                                  const Overflow& overflow) {
+  std::lock_guard<std::mutex> lock(log_mtx_);
+
+  Reconfigure([bytes, &overflow](Config& config) {
+    config.queue_budget = bytes;
+    config.overflow = overflow;
+  });
+}
+
+/**
+ * Setting the lowest level written as soon as possible: such a record
+ * makes a batch of everything queued so far, so the output stays in order
+ */
+void LogHandler::set_priority_level(const LogLevel& level) {
+  std::lock_guard<std::mutex> lock(log_mtx_);
+
+  Reconfigure([&level](Config& config) { config.priority_level = level; });
+}
+
+/**
+ * Setting when written records are fsynced
+ */
+void LogHandler::set_durability(const Durability& durability) {
+  std::lock_guard<std::mutex> lock(log_mtx_);
+
+  Reconfigure(
+      [&durability](Config& config) { config.durability = durability; });
+}
+
+void LogHandler::set_sync_period(const unsigned milliseconds) {
+  std::lock_guard<std::mutex> lock(log_mtx_);
+
+  Reconfigure([milliseconds](Config& config) {
+    config.sync_period = std::chrono::milliseconds(milliseconds);
+  });
+}
+
+/**
+ * Setting how many records logged before Init() are kept, later ones are
+ * dropped. Too late once the first of them is logged.
+ */
+void LogHandler::set_early_buffer_size(const unsigned size) {
+  std::lock_guard<std::mutex> lock(log_mtx_);
+  if (!is_stop_ || early_next_.load() > 0) return;
+
+  early_buffer_size_ = size;
+}
+
+/**
+ * Setting how many recent records the flight recorder keeps, 0 disables it
+ */
+void LogHandler::set_flight_recorder_size(const unsigned size) {
+  std::lock_guard<std::mutex> lock(log_mtx_);
   if (!is_stop_) return;
 
-  max_buffer_size_ = size;
+  flight_recorder_size_ = size;
+}
+
+/**
+ * Setting the lowest level the flight recorder keeps, records below the
+ * log level are then recorded but not written
+ */
+void LogHandler::set_flight_recorder_level(const LogLevel& level) {
+  std::lock_guard<std::mutex> lock(log_mtx_);
+  if (!is_stop_) return;
+
+  flight_recorder_level_ = level;
+}
+
+/**
+ * Setting the file the flight recorder is dumped to on SIGSEGV, SIGABRT
+ * or SIGBUS, decode it with logpp-decode
+ */
+void LogHandler::set_crash_dump_file(const std::string& path) {
+  std::lock_guard<std::mutex> lock(log_mtx_);
+  if (!is_stop_) return;
+
+  crash_dump_file_ = path;
+}
+
+/**
+ * Setting the config file read by Init() and watched afterwards
+ */
+void LogHandler::set_config_file(const std::string& path) {
+  std::lock_guard<std::mutex> lock(log_mtx_);
+  if (!is_stop_) return;
+
+  config_file_ = path;
+}
+
+/**
+ * Setting whether SIGHUP reopens the sinks' files, from Init() on
+ */
+void LogHandler::set_reopen_on_sighup(const bool is_enabled) {
+  std::lock_guard<std::mutex> lock(log_mtx_);
+  if (!is_stop_) return;
+
+  is_reopen_on_sighup_ = is_enabled;
+}
+
+/**
+ * Setting whether Log() calls are timed, costs two clock reads per record
+ */
+void LogHandler::set_latency_histogram(const bool is_enabled) {
+  std::lock_guard<std::mutex> lock(log_mtx_);
+  if (!is_stop_) return;
+
+  latency_histogram_.reset(is_enabled ? new LatencyHistogram(kCounterShards)
+                                      : nullptr);
 }
 
 /**
  * Log operation
  */
-void LogHandler::Log(const LogLevel& level, const std::string& msg,
-                     const std::string& file, const std::string& func,
-                     const unsigned line) {
-  if (is_stop_ || level < log_level_) return;
+void LogHandler::Log(const LogRecord& record) {
+  if (record.level < min_level_.load(std::memory_order_relaxed)) return;
+  if (!latency_histogram_) {
+    Enqueue(record);
+    return;
+  }
 
-  const auto output = FormatOutput(level, msg, file, func, line);
+  const auto start = std::chrono::steady_clock::now();
+  Enqueue(record);
+  const auto duration = std::chrono::steady_clock::now() - start;
+  latency_histogram_->Record(
+      ThreadShard(),
+      std::chrono::duration_cast<std::chrono::nanoseconds>(duration).count());
+}
 
-  // it may block
-  std::lock_guard<std::mutex> log_lock(log_mtx_);
+void LogHandler::Enqueue(const LogRecord& record) {
+  if (is_stop_.load(std::memory_order_acquire) && BufferEarly(record)) {
+    return;
+  }
 
-  if (is_stop_) {
-    throw std::logic_error("logging handler haven't been inited");
+  if (flight_recorder_) {
+    flight_recorder_->Record(record);
   }
+  if (record.level < log_level_.load(std::memory_order_relaxed)) return;
 
-  log_read_buffer_.push_back(output);
+  const std::size_t size = PackedSize(record);
+  bool is_notify;
+  {
+    // it may block
+    std::unique_lock<std::mutex> log_lock(log_mtx_);
 
-  // notify output thread to output
-  if (log_read_buffer_.size() >= max_buffer_size_) {
-    log_cv_.notify_one();
+    // over budget, a record is let in anyway when the queue is empty
+    while (is_closed_ ||
+           (config_->queue_budget > 0 && queued_bytes_ > 0 &&
+            queued_bytes_ + size > config_->queue_budget)) {
+      if (is_closed_ || config_->overflow == Overflow::DROP) {
+        log_lock.unlock();
+        counter_shards_[ThreadShard()].dropped.fetch_add(
+            1, std::memory_order_relaxed);
+        return;
+      }
+      log_event_->Notify();
+      space_cv_.wait(log_lock);
+    }
+
+    ++queued_seq_;
+    queued_bytes_.fetch_add(size, std::memory_order_relaxed);
+    log_read_buffer_.append(reinterpret_cast<const char*>(&record), size);
+    ++log_read_count_;
+    if (record.level >= config_->priority_level) {
+      // don't wait for a full batch, the records before it go along so
+      // the output stays in order
+      ++log_priority_count_;
+    }
+    is_notify = IsBatchReady();
+  }
+
+  counter_shards_[ThreadShard()].enqueued.fetch_add(1,
+                                                    std::memory_order_relaxed);
+
+  // notify output thread to output, outside of the lock so it doesn't
+  // wake up only to block on it
+  if (is_notify) {
+    log_event_->Notify();
   }
 }
 
 /**
- * Open a file stream
+ * Barrier behind every record logged so far, the output thread takes them
+ * right away and sets it once the sinks flushed them
  */
-void LogHandler::OpenLogStream() const {
-  if (log_stream_.is_open()) {
-    log_stream_.close();
+std::future<void> LogHandler::FlushAsync() {
+  std::promise<void> barrier;
+  std::future<void> flushed = barrier.get_future();
+
+  std::lock_guard<std::mutex> lock(log_mtx_);
+  if (is_stop_ || is_output_done_ || flushed_seq_ >= queued_seq_) {
+    barrier.set_value();
+    return flushed;
   }
+  flush_barriers_.emplace_back(queued_seq_, std::move(barrier));
+  log_event_->Notify();
+  return flushed;
+}
 
-  // test log directory and create directory if neccesary
-  if (access(log_dir_.c_str(), F_OK) != 0 ||
-      access(log_dir_.c_str(), W_OK) != 0) {
-    std::string dir;
-    for (std::size_t idx = 0; idx < log_dir_.length(); ++idx) {
-      // create new directory recusively
-      const char& curChar = log_dir_[idx];
+void LogHandler::Flush() { FlushAsync().wait(); }
 
-      // get current directory
-      if (curChar == '/') {
-        dir = log_dir_.substr(0, idx);  // get new directory path
-      } else if (idx + 1 == log_dir_.length()) {
-        dir = log_dir_;
-      } else {
-        continue;
-      }
+bool LogHandler::Flush(const std::chrono::milliseconds& timeout) {
+  return FlushAsync().wait_for(timeout) == std::future_status::ready;
+}
 
-      struct stat fileStat;
-      if (stat(dir.c_str(), &fileStat) < 0) {
-        if (mkdir(dir.c_str(), S_IRWXU | S_IRWXG | S_IRWXO) < 0) {
-          throw std::runtime_error("Cannot create directory");
-        }
-      }
-      if (!S_ISDIR(fileStat.st_mode)) {
-        throw std::runtime_error("Directory error");
-      }
+/**
+ * Keep a record logged before Init(), without a lock: static initializers
+ * may log before anything else runs. Returns false if Init() took the
+ * early records meanwhile, the record is then queued as usual.
+ */
+bool LogHandler::BufferEarly(const LogRecord& record) {
+  if (record.level < log_level_.load(std::memory_order_relaxed)) {
+    return true;
+  }
+
+  const unsigned idx = early_next_.fetch_add(1, std::memory_order_acq_rel);
+  if (idx >= kEarlyClosed) return false;
+  if (idx >= early_buffer_size_) {
+    counter_shards_[ThreadShard()].dropped.fetch_add(
+        1, std::memory_order_relaxed);
+    return true;
+  }
+
+  EarlySlot* slots = early_slots_.load(std::memory_order_acquire);
+  if (slots == nullptr) {
+    EarlySlot* fresh = new EarlySlot[early_buffer_size_];
+    if (early_slots_.compare_exchange_strong(slots, fresh,
+                                             std::memory_order_acq_rel)) {
+      slots = fresh;
+    } else {
+      delete[] fresh;  // another thread was first
+    }
+  }
+  std::memcpy(&slots[idx].record, &record, PackedSize(record));
+  slots[idx].is_ready.store(true, std::memory_order_release);
+  return true;
+}
+
+/**
+ * Queue the early records ahead of everything else, called by Init() with
+ * log_mtx_ held. Later callers of BufferEarly() queue as usual, after it.
+ */
+void LogHandler::QueueEarlyRecords() {
+  const unsigned count =
+      std::min(early_next_.exchange(kEarlyClosed, std::memory_order_acq_rel),
+               early_buffer_size_);
+  for (unsigned idx = 0; idx < count; ++idx) {
+    // wait for the records still being copied
+    EarlySlot* slots;
+    while ((slots = early_slots_.load(std::memory_order_acquire)) ==
+               nullptr ||
+           !slots[idx].is_ready.load(std::memory_order_acquire)) {
+      std::this_thread::yield();
     }
+    const LogRecord& record = slots[idx].record;
+    const std::size_t size = PackedSize(record);
+    ++queued_seq_;
+    queued_bytes_.fetch_add(size, std::memory_order_relaxed);
+    log_read_buffer_.append(reinterpret_cast<const char*>(&record), size);
+    ++log_read_count_;
+  }
+  counter_shards_[ThreadShard()].enqueued.fetch_add(
+      count, std::memory_order_relaxed);
+  delete[] early_slots_.exchange(nullptr);
+}
+
+/**
+ * Group commit: every caller waiting at the same time is released by the
+ * same fsync
+ */
+void LogHandler::Sync() {
+  std::unique_lock<std::mutex> lock(log_mtx_);
+  if (is_stop_ || is_output_done_) return;
+
+  const std::uint64_t target = queued_seq_;
+  if (synced_seq_ >= target) return;
+  sync_requested_seq_ = std::max(sync_requested_seq_, target);
+  log_event_->Notify();
+  while (synced_seq_ < target) {
+    sync_cv_.wait(lock);
+  }
+}
+
+/**
+ * Snapshot of the counters, the shards are added up here and not when
+ * logging
+ */
+LogHandler::Stats LogHandler::stats() const {
+  Stats stats;
+  {
+    std::lock_guard<std::mutex> lock(stats_mtx_);
+    stats = stats_;
+  }
+  for (unsigned idx = 0; idx < kCounterShards; ++idx) {
+    stats.enqueued +=
+        counter_shards_[idx].enqueued.load(std::memory_order_relaxed);
+    stats.dropped +=
+        counter_shards_[idx].dropped.load(std::memory_order_relaxed);
+  }
+  if (latency_histogram_) {
+    const auto summary = latency_histogram_->Summarize();
+    stats.log_calls = summary.count;
+    stats.log_p50 = std::chrono::nanoseconds(summary.p50);
+    stats.log_p99 = std::chrono::nanoseconds(summary.p99);
+    stats.log_p999 = std::chrono::nanoseconds(summary.p999);
+    stats.log_max = std::chrono::nanoseconds(summary.max);
   }
-  log_stream_.open(DirAndFileToPath(log_dir_, log_file_),
-                   std::ofstream::out | std::ofstream::app);
+  return stats;
+}
+
+/**
+ * Whether the batch is to be written without waiting for the flush
+ * interval, called with log_mtx_ held. Half the queue budget makes a batch
+ * too, so the other half is free while it is written.
+ */
+bool LogHandler::IsBatchReady() const {
+  return log_read_count_ >= config_->max_buffer_size ||
+         log_priority_count_ > 0 ||
+         (config_->queue_budget > 0 &&
+          log_read_buffer_.size() * 2 >= config_->queue_budget);
 }
 
-void LogHandler::FreshCurrentTime() {
-  std::time_t now;
-  std::time(&now);
-  current_time_ = std::ctime(&now);
-  current_time_.pop_back();
+/**
+ * Whether the output thread has to fsync, called with log_mtx_ held
+ */
+bool LogHandler::IsSyncDue(
+    const std::chrono::steady_clock::time_point& now) const {
+  if (now < sync_retry_time_) return false;  // a sink failed, back off
+  if (sync_requested_seq_ > synced_seq_) return true;
+  return config_->durability == Durability::PERIODIC &&
+         written_seq_ > synced_seq_ &&
+         now - last_sync_time_ >= config_->sync_period;
+}
+
+/**
+ * Record what a batch achieved, called by the output thread
+ */
+void LogHandler::UpdateStats(const std::size_t batch_size,
+                             const std::size_t queue_depth,
+                             const std::uint64_t bytes_written,
+                             const std::uint64_t lost_bytes,
+                             const std::int64_t oldest_time,
+                             const std::chrono::microseconds& write_time,
+                             const std::chrono::microseconds& flush_time,
+                             const std::chrono::microseconds& interval) {
+  const auto now = std::chrono::duration_cast<std::chrono::microseconds>(
+      std::chrono::system_clock::now().time_since_epoch());
+  const auto latency = batch_size == 0 ? std::chrono::microseconds(0)
+                                       : now - std::chrono::microseconds(
+                                                   oldest_time);
+
+  std::lock_guard<std::mutex> lock(stats_mtx_);
+  stats_.records += batch_size;
+  stats_.bytes_written = bytes_written;
+  stats_.lost_bytes = lost_bytes;
+  ++stats_.batches;
+  stats_.last_batch_size = batch_size;
+  stats_.max_batch_size = std::max(stats_.max_batch_size, batch_size);
+  stats_.max_queue_depth = std::max(stats_.max_queue_depth, queue_depth);
+  stats_.last_latency = latency;
+  stats_.max_latency = std::max(stats_.max_latency, latency);
+  stats_.write_time += write_time;
+  stats_.max_write_time = std::max(stats_.max_write_time, write_time);
+  stats_.flush_time += flush_time;
+  stats_.max_flush_time = std::max(stats_.max_flush_time, flush_time);
+  stats_.interval = interval;
 }
 
 /**
  * Another thread for output to file
  */
 void LogHandler::StartOutputThread() {
+  auto interval = std::chrono::microseconds::max();
+  std::size_t written_bytes = 0;
+  // of the next record in log_write_buffer_: once closing, it is written
+  // a batch at a time so the deadline can cut the drain short
+  std::size_t write_pos = 0;
+  const Config* config = nullptr;  // of the batch in hand
+  std::vector<std::shared_ptr<Sink>> sinks;  // open ones
+  std::uint64_t removed_bytes = 0;           // written by removed sinks
+  std::uint64_t removed_lost_bytes = 0;
+  unsigned seen_hangups = hangup_count.load(std::memory_order_relaxed);
+  auto next_moved_check = std::chrono::steady_clock::now();
   while (true) {
+    CheckConfigFile();
     if (!is_output_ready_) {
       // make sure engine is up
       std::lock_guard<std::mutex> lock(output_mtx_);  // protect isEngineReady
@@ -203,92 +967,253 @@ void LogHandler::StartOutputThread() {
       output_cv_.notify_one();
     }
 
+    bool is_sync;
+    bool is_closing;
+    bool is_done = false;
+    std::size_t queue_depth = 0;
     {
-      // get write buffer
+      // get the write buffer once the batch is full, holds a priority
+      // record, or the flush interval is over
       std::unique_lock<std::mutex> logLck(
           log_mtx_);  // protect log_read_buffer_
+      // the last batch is written, its memory is free again
+      queued_bytes_.fetch_sub(written_bytes, std::memory_order_relaxed);
+      written_bytes = 0;
+      if (config_->queue_budget > 0) {
+        space_cv_.notify_all();
+      }
+      // only this thread reads snapshots without the lock, and it is done
+      // with the replaced ones
+      for (const Config* retired : retired_configs_) {
+        delete retired;
+      }
+      retired_configs_.clear();
+      if (is_abort_output_ && write_pos < log_write_buffer_.size()) {
+        // out of time, the rest of the backlog in hand is lost too
+        const std::size_t left = CountRecords(log_write_buffer_, write_pos);
+        lost_records_ += left;
+        queued_bytes_.fetch_sub(log_write_buffer_.size() - write_pos,
+                                std::memory_order_relaxed);
+        counter_shards_[ThreadShard()].dropped.fetch_add(
+            left, std::memory_order_relaxed);
+        log_write_buffer_.clear();
+        write_pos = 0;
+      }
       while (log_write_buffer_.empty()) {
-        log_cv_.wait_for(logLck, flush_frequency_);
-        log_write_buffer_.swap(log_read_buffer_);
+        // the flush interval may have changed meanwhile
+        interval = config_->is_adaptive_flush
+                       ? std::min(std::max(interval,
+                                           config_->min_flush_interval),
+                                  config_->flush_interval)
+                       : config_->flush_interval;
+        bool is_timeout = false;
+        const auto now = std::chrono::steady_clock::now();
+        if (flush_barriers_.empty() && !IsSyncDue(now)) {
+          // a failed fsync is tried again at the retry time
+          auto timeout = interval;
+          if (now < sync_retry_time_) {
+            timeout = std::min(
+                timeout,
+                std::chrono::duration_cast<std::chrono::microseconds>(
+                    sync_retry_time_ - now) +
+                    std::chrono::microseconds(1));
+          }
+          // announce the wait before looking at the buffers once more, a
+          // producer filling them meanwhile then makes Wait() return
+          const std::uint32_t key = log_event_->PrepareWait();
+          if (IsBatchReady() || is_close_output_) {
+            log_event_->CancelWait();
+          } else {
+            logLck.unlock();
+            is_timeout = !log_event_->Wait(key, timeout);
+            CheckConfigFile();
+            logLck.lock();
+          }
+        }
+        if (is_abort_output_) {
+          // out of time, what is still queued is lost
+          lost_records_ += log_read_count_;
+          queued_bytes_.fetch_sub(log_read_buffer_.size(),
+                                  std::memory_order_relaxed);
+          counter_shards_[ThreadShard()].dropped.fetch_add(
+              log_read_count_, std::memory_order_relaxed);
+          log_read_buffer_.clear();
+          log_read_count_ = 0;
+          log_priority_count_ = 0;
+        }
+        queue_depth = std::max<std::size_t>(queue_depth, log_read_count_);
+        if (is_timeout || is_close_output_ || IsBatchReady() ||
+            !flush_barriers_.empty() ||
+            IsSyncDue(std::chrono::steady_clock::now())) {
+          log_write_buffer_.swap(log_read_buffer_);
+          log_read_count_ = 0;
+          log_priority_count_ = 0;
+          // every record queued so far is in hand
+          written_seq_ = queued_seq_;
+        }
 
-        // close output thread
-        if (is_close_output_ && log_write_buffer_.empty()) exit(0);
+        // everything is written, close output thread
+        if (is_close_output_ && log_write_buffer_.empty()) {
+          is_done = true;
+          break;
+        }
 
-        // fresh time
-        FreshCurrentTime();
+        // nothing new, but written records wait for a fsync or a flush
+        // barrier
+        if (IsSyncDue(std::chrono::steady_clock::now()) ||
+            !flush_barriers_.empty()) {
+          break;
+        }
+
+        // idle, don't keep waking up at the shortest interval
+        if (config_->is_adaptive_flush && is_timeout &&
+            log_write_buffer_.empty()) {
+          interval = std::min(interval * 2, config_->flush_interval);
+        }
       }
+      is_sync = IsSyncDue(std::chrono::steady_clock::now());
+      is_closing = is_close_output_;
+      config = config_;
     }
 
-    std::string toConsole;
-    std::string toFile;
-    for (const auto& logMsg : log_write_buffer_) {
-      if (output_.at(Output::CONSOLE)) {
-        toConsole += logMsg.color + logMsg.logMsg;
+    // sinks added meanwhile are open already, removed ones get no more
+    // records
+    if (sinks != config->sinks) {
+      for (const auto& sink : sinks) {
+        if (std::find(config->sinks.begin(), config->sinks.end(), sink) ==
+            config->sinks.end()) {
+          sink->Close();
+          removed_bytes += sink->bytes_written();
+          removed_lost_bytes += sink->lost_bytes();
+        }
       }
+      sinks = config->sinks;
+    }
+    if (is_done) break;
 
-      if (output_.at(Output::FILE)) {
-        toFile += logMsg.logMsg;
+    // logrotate: reopen on SIGHUP, or once the file was renamed. Only this
+    // thread waits for it
+    const auto now = std::chrono::steady_clock::now();
+    const unsigned hangups = hangup_count.load(std::memory_order_relaxed);
+    const bool is_hangup = is_reopen_on_sighup_ && hangups != seen_hangups;
+    if (is_hangup || now >= next_moved_check) {
+      seen_hangups = hangups;
+      next_moved_check = now + config->flush_interval;
+      for (const auto& sink : sinks) {
+        if (is_hangup || sink->IsMoved()) {
+          ReopenSink(*sink);
+        }
       }
     }
-    log_write_buffer_.clear();
-    if (output_.at(Output::CONSOLE)) {
-      OutputToConsole(toConsole);
+
+    batch_.clear();
+    const std::size_t batch_end = UnpackRecords(
+        log_write_buffer_, write_pos,
+        is_closing ? config->max_buffer_size : log_write_buffer_.size(),
+        batch_);
+    written_bytes = batch_end - write_pos;
+    write_pos = batch_end;
+    if (write_pos == log_write_buffer_.size()) {
+      log_write_buffer_.clear();
+      write_pos = 0;
     }
 
-    if (output_.at(Output::FILE)) {
-      OutputToFile(toFile);
-      log_stream_ << std::flush;
+    if (config->durability == Durability::WARN) {
+      for (const auto& record : batch_) {
+        is_sync = is_sync || record.level >= LogLevel::WARN;
+      }
     }
-  }
-}
 
-/**
- * Print log to console
- */
-void LogHandler::OutputToConsole(const std::string& logMsg) const {
-  std::cout << logMsg;
-}
+    const auto write_start = std::chrono::steady_clock::now();
+    for (const auto& sink : sinks) {
+      sink->Write(batch_.data(), batch_.size());
+    }
+    const auto flush_start = std::chrono::steady_clock::now();
+    std::uint64_t bytes_written = removed_bytes;
+    std::uint64_t lost_bytes = removed_lost_bytes;
+    bool is_synced = is_sync;  // by every sink
+    for (const auto& sink : sinks) {
+      if (is_sync) {
+        is_synced = sink->Sync() && is_synced;
+      } else {
+        sink->Flush();
+      }
+      bytes_written += sink->bytes_written();
+      lost_bytes += sink->lost_bytes();
+    }
+    const auto flush_end = std::chrono::steady_clock::now();
+    const std::size_t batch_size = batch_.size();
+    std::int64_t oldest_time = 0;
+    for (const auto& record : batch_) {
+      if (oldest_time == 0 || record.time < oldest_time) {
+        oldest_time = record.time;
+      }
+    }
 
-/**
- * Print log to log file
- */
-void LogHandler::OutputToFile(const std::string& logMsg) const {
-  log_stream_ << logMsg;
-}
+    if (config->is_adaptive_flush) {
+      // full batches: throughput is high, wait longer to batch more.
+      // shallow queue: wait less for lower latency
+      if (batch_size >= config->max_buffer_size) {
+        interval = std::min(interval * 2, config->flush_interval);
+      } else {
+        interval = std::max(interval / 2, config->min_flush_interval);
+      }
+    }
+    UpdateStats(batch_size, queue_depth, bytes_written, lost_bytes,
+                oldest_time,
+                std::chrono::duration_cast<std::chrono::microseconds>(
+                    flush_start - write_start),
+                std::chrono::duration_cast<std::chrono::microseconds>(
+                    flush_end - flush_start),
+                interval);
 
-/**
- * get formatted output log
- */
-LogHandler::OutputEntity LogHandler::FormatOutput(const LogLevel& level,
-                                                  const std::string& msg,
-                                                  const std::string& file,
-                                                  const std::string& func,
-                                                  const unsigned line) const {
-  std::string color;
-  switch (level) {
-    case LogLevel::TRACE:
-      color = "\x1b[35m";  // magenta
-      break;
-    case LogLevel::DEBUG:
-      color = "\x1b[34m";  // blue
-      break;
-    case LogLevel::INFO:
-      color = "\x1b[32m";  // green
-      break;
-    case LogLevel::WARN:
-      color = "\x1b[33m";  // yellow
-      break;
-    case LogLevel::ERROR:
-      color = "\x1b[31m";  // red
-      break;
+    std::lock_guard<std::mutex> lock(log_mtx_);
+    // a sink that can't write, e.g. on a full disk, keeps Sync() waiting:
+    // another fsync is tried after a backoff
+    if (is_synced) {
+      last_sync_time_ = std::chrono::steady_clock::now();
+      synced_seq_ = written_seq_;
+      sync_retry_backoff_ = kMinSyncRetryBackoff;
+      sync_cv_.notify_all();
+    } else if (is_sync) {
+      sync_retry_time_ = std::chrono::steady_clock::now() + sync_retry_backoff_;
+      sync_retry_backoff_ =
+          std::min(sync_retry_backoff_ * 2, kMaxSyncRetryBackoff);
+    }
+    flushed_seq_ = written_seq_;
+    while (!flush_barriers_.empty() &&
+           flush_barriers_.front().first <= flushed_seq_) {
+      flush_barriers_.front().second.set_value();
+      flush_barriers_.pop_front();
+    }
+  }
+
+  for (const auto& sink : sinks) {
+    if (config->durability != Durability::NONE) {
+      sink->Sync();
+    }
+    sink->Close();
+  }
+  // Close() gives up on what is still unwritten
+  {
+    std::uint64_t bytes_written = removed_bytes;
+    std::uint64_t lost_bytes = removed_lost_bytes;
+    for (const auto& sink : sinks) {
+      bytes_written += sink->bytes_written();
+      lost_bytes += sink->lost_bytes();
+    }
+    std::lock_guard<std::mutex> lock(stats_mtx_);
+    stats_.bytes_written = bytes_written;
+    stats_.lost_bytes = lost_bytes;
+  }
+  std::lock_guard<std::mutex> lock(log_mtx_);
+  is_output_done_ = true;
+  // nothing left to wait for
+  synced_seq_ = queued_seq_;
+  sync_cv_.notify_all();
+  for (auto& barrier : flush_barriers_) {
+    barrier.second.set_value();
   }
-  char buffer[kMaxMsgSize];
-  snprintf(buffer, kMaxMsgSize, "%s -> [%s::%s::%u] %s >> %s\n",
-           GetLogLevel(level).c_str(), file.c_str(), func.c_str(), line,
-           current_time_.c_str(), msg.c_str());
-  OutputEntity output;
-  output.logMsg = buffer;
-  output.color = color;
-  return output;
+  flush_barriers_.clear();
 }
 }
@@ -0,0 +1,148 @@
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <vector>
+#include <dirent.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include "helper.h"
+#include "log_pruner.h"
+
+namespace logger {
+
+namespace {
+
+const std::chrono::seconds kPrunePeriod(60);
+// ioprio_set(2), glibc has no wrapper
+const int kIoprioWhoProcess = 1;
+const int kIoprioClassIdle = 3;
+const int kIoprioClassShift = 13;
+
+struct RotatedFile {
+  std::string path;
+  std::uint64_t size;
+  timespec mtime;
+};
+
+bool IsOlder(const RotatedFile& lhs, const RotatedFile& rhs) {
+  if (lhs.mtime.tv_sec != rhs.mtime.tv_sec) {
+    return lhs.mtime.tv_sec < rhs.mtime.tv_sec;
+  }
+  return lhs.mtime.tv_nsec < rhs.mtime.tv_nsec;
+}
+
+bool EndsWith(const std::string& text, const std::string& suffix) {
+  return text.size() >= suffix.size() &&
+         text.compare(text.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+/**
+ * app.log.1, app.log.2.gz, app.log-20240131.xz: a number or a date after a
+ * dot or a dash, maybe compressed. Not app.log.lock or app.log.bin.
+ */
+bool IsRotatedCopy(const std::string& name, const std::string& log_file) {
+  if (name.size() <= log_file.size() + 1 ||
+      name.compare(0, log_file.size(), log_file) != 0) {
+    return false;
+  }
+  const char separator = name[log_file.size()];
+  if (separator != '.' && separator != '-') return false;
+  std::string suffix = name.substr(log_file.size() + 1);
+  if (EndsWith(suffix, ".gz") || EndsWith(suffix, ".xz")) {
+    suffix.resize(suffix.size() - 3);
+  }
+  if (suffix.empty() || !std::isdigit(static_cast<unsigned char>(suffix[0]))) {
+    return false;
+  }
+  return suffix.find_first_not_of("0123456789-_.") == std::string::npos;
+}
+}
+
+LogPruner::LogPruner(const std::string& log_dir, const std::string& log_file,
+                     std::uint64_t max_dir_size, unsigned max_rotated_files)
+    : log_dir_(log_dir),
+      log_file_(log_file),
+      max_dir_size_(max_dir_size),
+      max_rotated_files_(max_rotated_files),
+      pruned_files_(0),
+      mtx_(),
+      cv_(),
+      is_stop_(false),
+      is_requested_(false),
+      thread_() {
+  thread_ = std::thread(&LogPruner::Run, this);
+}
+
+LogPruner::~LogPruner() {
+  {
+    std::lock_guard<std::mutex> lock(mtx_);
+    is_stop_ = true;
+  }
+  cv_.notify_one();
+  thread_.join();
+}
+
+void LogPruner::Prune() {
+  {
+    std::lock_guard<std::mutex> lock(mtx_);
+    is_requested_ = true;
+  }
+  cv_.notify_one();
+}
+
+void LogPruner::Run() {
+  // deleting large files mustn't compete with the application's I/O
+  syscall(SYS_ioprio_set, kIoprioWhoProcess, 0,
+          kIoprioClassIdle << kIoprioClassShift);
+
+  std::unique_lock<std::mutex> lock(mtx_);
+  while (!is_stop_) {
+    lock.unlock();
+    PruneOnce();
+    lock.lock();
+    cv_.wait_for(lock, kPrunePeriod,
+                 [this] { return is_stop_ || is_requested_; });
+    is_requested_ = false;
+  }
+}
+
+/**
+ * One pass over the directory, the oldest copies go until both limits hold
+ */
+void LogPruner::PruneOnce() {
+  DIR* dir = opendir(log_dir_.empty() ? "." : log_dir_.c_str());
+  if (dir == nullptr) return;
+
+  std::vector<RotatedFile> rotated;
+  std::uint64_t dir_size = 0;
+  while (const dirent* entry = readdir(dir)) {
+    const std::string name = entry->d_name;
+    const std::string path = DirAndFileToPath(log_dir_, name);
+    struct stat fileStat;
+    if (lstat(path.c_str(), &fileStat) != 0 || !S_ISREG(fileStat.st_mode)) {
+      continue;
+    }
+    dir_size += fileStat.st_size;
+    if (IsRotatedCopy(name, log_file_)) {
+      rotated.push_back({path, static_cast<std::uint64_t>(fileStat.st_size),
+                         fileStat.st_mtim});
+    }
+  }
+  closedir(dir);
+
+  std::sort(rotated.begin(), rotated.end(), IsOlder);
+  std::size_t count = rotated.size();
+  for (const auto& file : rotated) {
+    if ((max_dir_size_ == 0 || dir_size <= max_dir_size_) &&
+        (max_rotated_files_ == 0 || count <= max_rotated_files_)) {
+      break;
+    }
+    if (unlink(file.path.c_str()) == 0) {
+      dir_size -= std::min(dir_size, file.size);
+      --count;
+      ++pruned_files_;
+    }
+  }
+}
+}
@@ -0,0 +1,50 @@
+#ifndef LOGGING_PLUS_PLUS_LOG_PRUNER_H_
+#define LOGGING_PLUS_PLUS_LOG_PRUNER_H_
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+
+namespace logger {
+
+/**
+ * Deletes the rotated copies of a log file (app.log.1, app.log.2.gz,
+ * app.log-20240131...), oldest first, while its directory takes more than
+ * max_dir_size bytes or there are more than max_rotated_files copies, 0
+ * for no limit. Other files count towards the size but are never deleted,
+ * nor is the live file. Runs on its own thread at idle I/O priority, every
+ * minute and whenever Prune() asks.
+ */
+class LogPruner {
+ public:
+  LogPruner(const std::string &log_dir, const std::string &log_file,
+            std::uint64_t max_dir_size, unsigned max_rotated_files);
+  LogPruner(const LogPruner &) = delete;
+  LogPruner &operator=(const LogPruner &) = delete;
+  ~LogPruner();
+
+  // look again soon, e.g. after the file was rotated
+  void Prune();
+  std::uint64_t pruned_files() const { return pruned_files_; }
+
+ private:
+  void Run();
+  void PruneOnce();
+
+  const std::string log_dir_;
+  const std::string log_file_;
+  const std::uint64_t max_dir_size_;
+  const unsigned max_rotated_files_;
+  std::atomic<std::uint64_t> pruned_files_;
+  std::mutex mtx_;
+  std::condition_variable cv_;
+  bool is_stop_;
+  bool is_requested_;
+  std::thread thread_;
+};
+}
+
+#endif /* LOGGING_PLUS_PLUS_LOG_PRUNER_H_ */
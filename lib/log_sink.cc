@@ -0,0 +1,328 @@
+#include <algorithm>
+#include <cerrno>
+#include <iostream>
+#include <stdexcept>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "../include/log_sink.h"
+#include "binary_log.h"
+#include "helper.h"
+#include "log_format.h"
+#include "log_pruner.h"
+
+namespace logger {
+
+static const std::chrono::milliseconds kMinRetryBackoff(100);
+static const std::chrono::milliseconds kMaxRetryBackoff(5000);
+
+/**
+ * Test log directory and create directory if neccesary
+ */
+static void CreateLogDirectory(const std::string& log_dir) {
+  if (access(log_dir.c_str(), F_OK) == 0 &&
+      access(log_dir.c_str(), W_OK) == 0) {
+    return;
+  }
+  std::string dir;
+  for (std::size_t idx = 0; idx < log_dir.length(); ++idx) {
+    // create new directory recusively
+    const char& curChar = log_dir[idx];
+
+    // get current directory
+    if (curChar == '/') {
+      dir = log_dir.substr(0, idx);  // get new directory path
+    } else if (idx + 1 == log_dir.length()) {
+      dir = log_dir;
+    } else {
+      continue;
+    }
+    if (dir.empty()) continue;  // root of an absolute path
+
+    struct stat fileStat;
+    if (stat(dir.c_str(), &fileStat) < 0) {
+      if (mkdir(dir.c_str(), S_IRWXU | S_IRWXG | S_IRWXO) < 0) {
+        throw std::runtime_error("Cannot create directory");
+      }
+    } else if (!S_ISDIR(fileStat.st_mode)) {
+      throw std::runtime_error("Directory error");
+    }
+  }
+}
+
+/**
+ * Open a file for appending, creating its directory
+ */
+static int OpenLogFile(const std::string& log_dir,
+                       const std::string& log_file) {
+  CreateLogDirectory(log_dir);
+  const int fd = open(DirAndFileToPath(log_dir, log_file).c_str(),
+                      O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+  if (fd < 0) {
+    throw std::runtime_error("Cannot open log file");
+  }
+  return fd;
+}
+
+/**
+ * Device and inode of an open file
+ */
+static void GetFileId(int fd, std::uint64_t& device, std::uint64_t& inode) {
+  struct stat fileStat;
+  if (fstat(fd, &fileStat) == 0) {
+    device = fileStat.st_dev;
+    inode = fileStat.st_ino;
+  }
+}
+
+/**
+ * Whether the path is gone or names another file than the open one
+ */
+static bool IsFileMoved(const std::string& path, std::uint64_t device,
+                        std::uint64_t inode) {
+  struct stat fileStat;
+  return stat(path.c_str(), &fileStat) != 0 || fileStat.st_dev != device ||
+         fileStat.st_ino != inode;
+}
+
+static std::size_t WriteAll(int fd, const std::string& data) {
+  std::size_t written = 0;
+  while (written < data.size()) {
+    const ssize_t size =
+        write(fd, data.data() + written, data.size() - written);
+    if (size < 0 && errno == EINTR) continue;
+    if (size <= 0) break;
+    written += size;
+  }
+  return written;
+}
+
+/**
+ * fdatasync, a file that can't be synced, e.g. /dev/null or a pipe, has
+ * nothing to lose
+ */
+static bool SyncFile(int fd) {
+  return fdatasync(fd) == 0 || errno == EINVAL || errno == EROFS;
+}
+
+ConsoleSink::ConsoleSink() : formatter_(new LogFormatter()), buffer_() {}
+
+ConsoleSink::~ConsoleSink() {}
+
+void ConsoleSink::Write(const LogRecord* records, std::size_t count) {
+  for (std::size_t idx = 0; idx < count; ++idx) {
+    formatter_->Format(records[idx], true, buffer_);
+  }
+  std::cout << buffer_;
+  bytes_written_ += buffer_.size();
+  buffer_.clear();
+}
+
+void ConsoleSink::Flush() { std::cout << std::flush; }
+
+FileSink::FileSink(const std::string& log_path, std::size_t max_spill_size)
+    : log_dir_(),
+      log_file_(),
+      log_fd_(-1),
+      log_device_(0),
+      log_inode_(0),
+      max_dir_size_(0),
+      max_rotated_files_(0),
+      pruner_(),
+      max_spill_size_(max_spill_size),
+      is_failing_(false),
+      next_retry_time_(),
+      retry_backoff_(kMinRetryBackoff),
+      formatter_(new LogFormatter()),
+      buffer_() {
+  PathToFile(log_path, log_dir_, log_file_);
+}
+
+FileSink::~FileSink() { Close(); }
+
+/**
+ * Open the log file
+ */
+void FileSink::Open() {
+  if (log_fd_ >= 0) {
+    close(log_fd_);
+  }
+  log_fd_ = OpenLogFile(log_dir_, log_file_);
+  GetFileId(log_fd_, log_device_, log_inode_);
+  if (!pruner_ && (max_dir_size_ > 0 || max_rotated_files_ > 0)) {
+    pruner_.reset(new LogPruner(log_dir_, log_file_, max_dir_size_,
+                                max_rotated_files_));
+  }
+}
+
+/**
+ * Setting the limits of the log directory, before Open()
+ */
+void FileSink::set_retention(std::uint64_t max_dir_size,
+                             unsigned max_rotated_files) {
+  max_dir_size_ = max_dir_size;
+  max_rotated_files_ = max_rotated_files;
+}
+
+void FileSink::Write(const LogRecord* records, std::size_t count) {
+  for (std::size_t idx = 0; idx < count; ++idx) {
+    const std::size_t line_start = buffer_.size();
+    formatter_->Format(records[idx], false, buffer_);
+    if (is_failing_ && buffer_.size() > max_spill_size_) {
+      // the spill is full, the oldest lines stay
+      lost_bytes_ += buffer_.size() - line_start;
+      buffer_.resize(line_start);
+    }
+  }
+}
+
+/**
+ * Write what is buffered. A failed write keeps the rest for a retry once
+ * the backoff is over, a partial line included: the file stays readable.
+ */
+void FileSink::Flush() {
+  if (log_fd_ < 0 || buffer_.empty()) return;
+  const auto now = std::chrono::steady_clock::now();
+  if (is_failing_ && now < next_retry_time_) return;
+
+  const std::size_t written = WriteAll(log_fd_, buffer_);
+  bytes_written_ += written;
+  buffer_.erase(0, written);
+  if (buffer_.empty()) {
+    is_failing_ = false;
+    retry_backoff_ = kMinRetryBackoff;
+    return;
+  }
+  is_failing_ = true;
+  next_retry_time_ = now + retry_backoff_;
+  retry_backoff_ = std::min(retry_backoff_ * 2, kMaxRetryBackoff);
+}
+
+/**
+ * The spill isn't on disk, whatever fdatasync says
+ */
+bool FileSink::Sync() {
+  Flush();
+  if (!buffer_.empty()) return false;
+  return log_fd_ < 0 || SyncFile(log_fd_);
+}
+
+void FileSink::Close() {
+  if (log_fd_ < 0) return;
+  next_retry_time_ = std::chrono::steady_clock::time_point();  // last chance
+  Flush();
+  lost_bytes_ += buffer_.size();
+  buffer_.clear();
+  close(log_fd_);
+  log_fd_ = -1;
+  pruner_.reset();
+}
+
+bool FileSink::IsMoved() const {
+  if (log_fd_ < 0) return false;
+  return IsFileMoved(DirAndFileToPath(log_dir_, log_file_), log_device_,
+                     log_inode_);
+}
+
+void FileSink::Reopen() {
+  if (log_fd_ < 0) return;
+  const int fd = OpenLogFile(log_dir_, log_file_);
+  Flush();
+  close(log_fd_);
+  log_fd_ = fd;
+  GetFileId(log_fd_, log_device_, log_inode_);
+  if (pruner_) {
+    pruner_->Prune();  // rotated just now
+  }
+}
+
+BinaryFileSink::BinaryFileSink(const std::string& log_path)
+    : log_dir_(),
+      log_file_(),
+      log_fd_(-1),
+      log_device_(0),
+      log_inode_(0),
+      writer_(new BinaryLogWriter()),
+      buffer_() {
+  PathToFile(log_path, log_dir_, log_file_);
+}
+
+BinaryFileSink::~BinaryFileSink() { Close(); }
+
+/**
+ * Open the binary log file, records are appended as a new segment
+ */
+void BinaryFileSink::Open() {
+  if (log_fd_ >= 0) {
+    close(log_fd_);
+  }
+  log_fd_ = OpenLogFile(log_dir_, log_file_);
+  GetFileId(log_fd_, log_device_, log_inode_);
+  writer_->StartSegment(buffer_);
+}
+
+void BinaryFileSink::Write(const LogRecord* records, std::size_t count) {
+  for (std::size_t idx = 0; idx < count; ++idx) {
+    writer_->Add(records[idx]);
+  }
+  writer_->FinishBlock(buffer_);
+}
+
+/**
+ * A failed write loses the blocks: what got through is cut off when the
+ * file allows it, and a new segment follows since their call sites are
+ * lost too
+ */
+void BinaryFileSink::Flush() {
+  if (log_fd_ < 0 || buffer_.empty()) return;
+  const std::size_t written = WriteAll(log_fd_, buffer_);
+  if (written == buffer_.size()) {
+    bytes_written_ += written;
+    buffer_.clear();
+    return;
+  }
+
+  const off_t end = lseek(log_fd_, 0, SEEK_END);
+  if (end >= static_cast<off_t>(written) &&
+      ftruncate(log_fd_, end - written) == 0) {
+    lost_bytes_ += buffer_.size();
+  } else {
+    bytes_written_ += written;
+    lost_bytes_ += buffer_.size() - written;
+  }
+  buffer_.clear();
+  writer_->StartSegment(buffer_);
+}
+
+bool BinaryFileSink::Sync() {
+  Flush();
+  return log_fd_ < 0 || SyncFile(log_fd_);
+}
+
+void BinaryFileSink::Close() {
+  if (log_fd_ < 0) return;
+  Flush();
+  close(log_fd_);
+  log_fd_ = -1;
+}
+
+bool BinaryFileSink::IsMoved() const {
+  if (log_fd_ < 0) return false;
+  return IsFileMoved(DirAndFileToPath(log_dir_, log_file_), log_device_,
+                     log_inode_);
+}
+
+/**
+ * The new file starts with a segment of its own, logpp-decode reads it
+ * without the old one
+ */
+void BinaryFileSink::Reopen() {
+  if (log_fd_ < 0) return;
+  const int fd = OpenLogFile(log_dir_, log_file_);
+  Flush();
+  close(log_fd_);
+  log_fd_ = fd;
+  GetFileId(log_fd_, log_device_, log_inode_);
+  writer_->StartSegment(buffer_);
+}
+}
@@ -1,30 +1,51 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
 #include "../include/log_stream.h"
 
 namespace logger {
-LogStream::LogStream(const LogLevel& level, const std::string& file,
-                     const std::string& func, const unsigned line)
-    : log_handler_(LogHandler::GetHandler()),
-      log_level_(level),
-      filename(file),
-      funcname(func),
-      line(line) {}
+LogStream::LogStream(const LogLevel& level, const char* file,
+                     const char* func, const unsigned line)
+    : LogStream(LogHandler::GetHandler(), level, file, func, line) {}
 
-LogStream::~LogStream() {
-  log_handler_.Log(log_level_, log_msg_, filename, funcname, line);
+LogStream::LogStream(LogHandler& handler, const LogLevel& level,
+                     const char* file, const char* func, const unsigned line)
+    : log_handler_(handler) {
+  record_.level = level;
+  record_.line = line;
+  record_.file = file;
+  record_.func = func;
+  record_.time = std::chrono::duration_cast<std::chrono::microseconds>(
+                     std::chrono::system_clock::now().time_since_epoch())
+                     .count();
+  record_.args_size = 0;
 }
 
+LogStream::~LogStream() { log_handler_.Log(record_); }
+
 LogStream& LogStream::operator<<(const std::string& msg) {
-  log_msg_ += msg;
+  record_.AppendString(msg.data(), msg.size());
   return *this;
 }
 
 LogStream& LogStream::operator<<(const char* msg) {
-  log_msg_ += msg;
+  record_.AppendString(msg, std::strlen(msg));
   return *this;
 }
 
 LogStream& LogStream::operator<<(char* msg) {
-  log_msg_ += msg;
+  record_.AppendString(msg, std::strlen(msg));
   return *this;
 }
+
+/**
+ * long double doesn't fit the binary encoding, keep its text
+ */
+void LogStream::Append(const long double& msg, std::true_type,
+                       std::true_type) {
+  char buffer[kMaxMsgSize];
+  const int size = snprintf(buffer, sizeof(buffer), "%Lf", msg);
+  record_.AppendString(buffer, size < 0 ? 0 : std::min<std::size_t>(
+                                                  size, sizeof(buffer) - 1));
+}
 }
@@ -0,0 +1,193 @@
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "../include/log_sink.h"
+#include "../include/shm_ring_reader.h"
+#include "log_format.h"
+#include "shm_ring.h"
+
+namespace logger {
+
+ShmRingSink::ShmRingSink(const std::string& name, std::uint32_t slot_count,
+                         std::uint32_t slot_size)
+    : name_(name),
+      slot_count_(slot_count),
+      slot_size_(slot_size),
+      ring_(nullptr),
+      ring_size_(ShmRingSize(slot_count, slot_size)),
+      formatter_(new LogFormatter()),
+      line_() {
+  if (!IsShmRingGeometry(slot_count, slot_size)) {
+    throw std::invalid_argument("Bad shared memory ring geometry");
+  }
+}
+
+ShmRingSink::~ShmRingSink() { Close(); }
+
+void ShmRingSink::Close() {
+  if (ring_ == nullptr) return;
+  munmap(ring_, ring_size_);
+  shm_unlink(name_.c_str());
+  ring_ = nullptr;
+}
+
+/**
+ * Create or resize the shared memory ring, a ring of the same geometry
+ * keeps its sequence so attached readers carry on
+ */
+void ShmRingSink::Open() {
+  if (ring_ != nullptr) return;
+
+  const int fd = shm_open(name_.c_str(), O_CREAT | O_RDWR, 0644);
+  if (fd < 0) {
+    throw std::runtime_error("Cannot open shared memory ring");
+  }
+  struct stat fileStat;
+  const bool is_reuse = fstat(fd, &fileStat) == 0 &&
+                        static_cast<std::size_t>(fileStat.st_size) ==
+                            ring_size_;
+  if (!is_reuse && ftruncate(fd, ring_size_) < 0) {
+    close(fd);
+    throw std::runtime_error("Cannot size shared memory ring");
+  }
+  void* mapped =
+      mmap(nullptr, ring_size_, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  close(fd);
+  if (mapped == MAP_FAILED) {
+    throw std::runtime_error("Cannot map shared memory ring");
+  }
+  ring_ = static_cast<ShmRingHeader*>(mapped);
+
+  if (!is_reuse || std::memcmp(ring_->magic, kShmRingMagic, 8) != 0 ||
+      ring_->version != kShmRingVersion || ring_->slot_count != slot_count_ ||
+      ring_->slot_size != slot_size_) {
+    std::memset(mapped, 0, ring_size_);
+    ring_->version = kShmRingVersion;
+    ring_->slot_count = slot_count_;
+    ring_->slot_size = slot_size_;
+    ring_->write_seq.store(0, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    std::memcpy(ring_->magic, kShmRingMagic, 8);  // readers check it last
+  }
+}
+
+void ShmRingSink::Write(const LogRecord* records, std::size_t count) {
+  if (ring_ == nullptr) return;
+
+  const std::size_t capacity = slot_size_ - sizeof(ShmSlotHeader);
+  std::uint64_t seq = ring_->write_seq.load(std::memory_order_relaxed);
+  for (std::size_t idx = 0; idx < count; ++idx, ++seq) {
+    line_.clear();
+    formatter_->Format(records[idx], false, line_);
+    const std::size_t size = std::min(line_.size(), capacity);
+
+    ShmSlotHeader* slot = ShmRingSlot(ring_, seq, slot_count_, slot_size_);
+    slot->seq.store(2 * seq + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    std::memcpy(ShmSlotData(slot), line_.data(), size);
+    slot->size = static_cast<std::uint32_t>(size);
+    slot->seq.store(2 * seq + 2, std::memory_order_release);
+    ring_->write_seq.store(seq + 1, std::memory_order_release);
+    bytes_written_ += size;
+  }
+}
+
+ShmRingReader::ShmRingReader()
+    : name_(),
+      ring_(nullptr),
+      ring_size_(0),
+      slot_count_(0),
+      slot_size_(0),
+      next_seq_(0),
+      lost_records_(0) {}
+
+ShmRingReader::~ShmRingReader() {
+  if (ring_ != nullptr) {
+    munmap(ring_, ring_size_);
+  }
+}
+
+bool ShmRingReader::Open(const std::string& name) {
+  const int fd = shm_open(name.c_str(), O_RDONLY, 0);
+  if (fd < 0) return false;
+
+  struct stat fileStat;
+  void* mapped = MAP_FAILED;
+  if (fstat(fd, &fileStat) == 0 &&
+      static_cast<std::size_t>(fileStat.st_size) >= sizeof(ShmRingHeader)) {
+    mapped = mmap(nullptr, fileStat.st_size, PROT_READ, MAP_SHARED, fd, 0);
+  }
+  close(fd);
+  if (mapped == MAP_FAILED) return false;
+
+  // the writer isn't trusted more than the file size, and the geometry
+  // checked here is the one used: the header may change under the reader
+  auto ring = static_cast<ShmRingHeader*>(mapped);
+  std::atomic_thread_fence(std::memory_order_acquire);
+  const std::uint32_t slot_count = ring->slot_count;
+  const std::uint32_t slot_size = ring->slot_size;
+  if (std::memcmp(ring->magic, kShmRingMagic, 8) != 0 ||
+      ring->version != kShmRingVersion ||
+      !IsShmRingGeometry(slot_count, slot_size) ||
+      ShmRingSize(slot_count, slot_size) >
+          static_cast<std::size_t>(fileStat.st_size)) {
+    munmap(mapped, fileStat.st_size);
+    return false;
+  }
+
+  if (ring_ != nullptr) {
+    munmap(ring_, ring_size_);
+  }
+  name_ = name;
+  ring_ = ring;
+  ring_size_ = fileStat.st_size;
+  slot_count_ = slot_count;
+  slot_size_ = slot_size;
+  // start from the oldest record still in the ring
+  const std::uint64_t write_seq =
+      ring_->write_seq.load(std::memory_order_acquire);
+  next_seq_ = write_seq > slot_count_ ? write_seq - slot_count_ : 0;
+  return true;
+}
+
+bool ShmRingReader::Next(std::string& out) {
+  if (ring_ == nullptr) return false;
+  // a writer restarted with another geometry: a new ring, attach to it
+  if (ring_->slot_count != slot_count_ || ring_->slot_size != slot_size_) {
+    const std::string name = name_;
+    if (!Open(name)) return false;
+  }
+
+  const std::size_t capacity = slot_size_ - sizeof(ShmSlotHeader);
+  while (true) {
+    const std::uint64_t write_seq =
+        ring_->write_seq.load(std::memory_order_acquire);
+    if (next_seq_ >= write_seq) return false;
+    if (write_seq - next_seq_ > slot_count_) {
+      lost_records_ += write_seq - next_seq_ - slot_count_;
+      next_seq_ = write_seq - slot_count_;
+    }
+
+    ShmSlotHeader* slot = ShmRingSlot(ring_, next_seq_, slot_count_,
+                                      slot_size_);
+    const std::uint64_t expected = 2 * next_seq_ + 2;
+    const std::uint64_t before = slot->seq.load(std::memory_order_acquire);
+    if (before == expected) {
+      const std::size_t size = std::min<std::size_t>(slot->size, capacity);
+      out.assign(ShmSlotData(slot), size);
+      std::atomic_thread_fence(std::memory_order_acquire);
+      if (slot->seq.load(std::memory_order_relaxed) == expected) {
+        ++next_seq_;
+        return true;
+      }
+    }
+    // overwritten by a newer record before or while reading
+    ++lost_records_;
+    ++next_seq_;
+  }
+}
+}
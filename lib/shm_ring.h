@@ -0,0 +1,65 @@
+#ifndef LOGGING_PLUS_PLUS_SHM_RING_H_
+#define LOGGING_PLUS_PLUS_SHM_RING_H_
+
+#include <atomic>
+#include <cstdint>
+
+namespace logger {
+
+/**
+ * Shared memory ring layout, one writer (ShmRingSink) and any number of
+ * readers (ShmRingReader):
+ *
+ *   header | slot 0 | slot 1 | ... | slot (slot_count - 1)
+ *
+ * Record n lives in slot n % slot_count. The slot sequence is a seqlock:
+ * 2n + 1 while record n is being written, 2n + 2 once it is complete.
+ * write_seq is the number of published records.
+ */
+constexpr char kShmRingMagic[] = "LOGPPSHM";
+constexpr std::uint32_t kShmRingVersion = 1;
+
+static_assert(ATOMIC_LLONG_LOCK_FREE == 2,
+              "shared memory ring needs lock-free 64 bit atomics");
+
+struct ShmRingHeader {
+  char magic[8];
+  std::uint32_t version;
+  std::uint32_t slot_count;
+  std::uint32_t slot_size;
+  alignas(64) std::atomic<std::uint64_t> write_seq;
+};
+
+struct alignas(16) ShmSlotHeader {
+  std::atomic<std::uint64_t> seq;
+  std::uint32_t size;
+};
+
+// room for a header and some text in every slot, and aligned slot headers
+inline bool IsShmRingGeometry(std::uint32_t slot_count,
+                              std::uint32_t slot_size) {
+  return slot_count > 0 && slot_size > sizeof(ShmSlotHeader) &&
+         slot_size % alignof(ShmSlotHeader) == 0;
+}
+
+inline std::size_t ShmRingSize(std::uint32_t slot_count,
+                               std::uint32_t slot_size) {
+  return sizeof(ShmRingHeader) +
+         static_cast<std::size_t>(slot_count) * slot_size;
+}
+
+// the geometry is the caller's, checked against its mapping
+inline ShmSlotHeader *ShmRingSlot(ShmRingHeader *header, std::uint64_t seq,
+                                  std::uint32_t slot_count,
+                                  std::uint32_t slot_size) {
+  char *slots = reinterpret_cast<char *>(header) + sizeof(ShmRingHeader);
+  return reinterpret_cast<ShmSlotHeader *>(
+      slots + (seq % slot_count) * slot_size);
+}
+
+inline char *ShmSlotData(ShmSlotHeader *slot) {
+  return reinterpret_cast<char *>(slot) + sizeof(ShmSlotHeader);
+}
+}
+
+#endif /* LOGGING_PLUS_PLUS_SHM_RING_H_ */
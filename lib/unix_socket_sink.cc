@@ -0,0 +1,132 @@
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include "../include/log_sink.h"
+#include "log_format.h"
+
+namespace logger {
+
+namespace {
+const std::chrono::milliseconds kMinConnectBackoff(100);
+const std::chrono::milliseconds kMaxConnectBackoff(5000);
+}
+
+UnixSocketSink::UnixSocketSink(const std::string& socket_path,
+                               std::size_t max_pending_size)
+    : socket_path_(socket_path),
+      max_pending_size_(max_pending_size),
+      socket_fd_(-1),
+      next_connect_time_(),
+      connect_backoff_(kMinConnectBackoff),
+      is_line_started_(false),
+      is_connected_(false),
+      dropped_records_(0),
+      formatter_(new LogFormatter()),
+      line_(),
+      pending_() {}
+
+UnixSocketSink::~UnixSocketSink() { Close(); }
+
+void UnixSocketSink::Write(const LogRecord* records, std::size_t count) {
+  for (std::size_t idx = 0; idx < count; ++idx) {
+    formatter_->Format(records[idx], false, line_);
+    if (pending_.size() + line_.size() > max_pending_size_) {
+      ++dropped_records_;
+      lost_bytes_ += line_.size();
+    } else {
+      pending_ += line_;
+    }
+    line_.clear();
+  }
+  Send();
+}
+
+void UnixSocketSink::Flush() { Send(); }
+
+void UnixSocketSink::Close() {
+  Send();  // last chance, don't wait for a slow collector
+  Disconnect();
+}
+
+/**
+ * Non-blocking connect, retried no more often than the backoff allows
+ */
+bool UnixSocketSink::Connect() {
+  const auto now = std::chrono::steady_clock::now();
+  if (now < next_connect_time_) return false;
+
+  sockaddr_un address;
+  std::memset(&address, 0, sizeof(address));
+  address.sun_family = AF_UNIX;
+  std::strncpy(address.sun_path, socket_path_.c_str(),
+               sizeof(address.sun_path) - 1);
+
+  socket_fd_ = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+  if (socket_fd_ >= 0 &&
+      connect(socket_fd_, reinterpret_cast<sockaddr*>(&address),
+              sizeof(address)) == 0) {
+    connect_backoff_ = kMinConnectBackoff;
+    is_connected_ = true;
+    return true;
+  }
+
+  Disconnect();
+  next_connect_time_ = now + connect_backoff_;
+  connect_backoff_ = std::min(connect_backoff_ * 2, kMaxConnectBackoff);
+  return false;
+}
+
+void UnixSocketSink::Disconnect() {
+  if (socket_fd_ >= 0) {
+    close(socket_fd_);
+    socket_fd_ = -1;
+  }
+  is_connected_ = false;
+
+  // the collector lost the head of this line, don't send it the tail
+  if (is_line_started_) {
+    const std::size_t line_end = pending_.find('\n');
+    const std::size_t line_tail =
+        line_end == std::string::npos ? pending_.size() : line_end + 1;
+    lost_bytes_ += line_tail;
+    pending_.erase(0, line_tail);
+    is_line_started_ = false;
+  }
+}
+
+/**
+ * Send as much of the pending lines as the socket takes right now
+ */
+void UnixSocketSink::Send() {
+  if (pending_.empty()) return;
+  if (socket_fd_ < 0 && !Connect()) return;
+
+  std::size_t sent = 0;
+  bool is_broken = false;
+  while (sent < pending_.size()) {
+    const ssize_t size = send(socket_fd_, pending_.data() + sent,
+                              pending_.size() - sent, MSG_NOSIGNAL);
+    if (size > 0) {
+      sent += size;
+    } else if (size < 0 && errno == EINTR) {
+      continue;
+    } else {
+      // full socket buffer, or the collector went away
+      is_broken = !(size < 0 && (errno == EAGAIN || errno == EWOULDBLOCK));
+      break;
+    }
+  }
+  if (sent > 0) {
+    bytes_written_ += sent;
+    is_line_started_ = pending_[sent - 1] != '\n';
+    pending_.erase(0, sent);
+  }
+  if (is_broken) {
+    Disconnect();
+  }
+}
+}
@@ -0,0 +1,62 @@
+#include "../include/logger.h"
+#include "test_helper.h"
+#include <cstdlib>
+#include <iostream>
+#include <new>
+#include <string>
+
+using logger::LogLevel::INFO;
+using logger::LogLevel::ERROR;
+
+/**
+ * Once warmed up, Log() mustn't touch the heap in the calling thread,
+ * whatever the argument types. Allocations of the output thread don't count.
+ */
+
+thread_local unsigned long long allocation_count = 0;
+
+void* operator new(std::size_t size) {
+  ++allocation_count;
+  void* ptr = std::malloc(size == 0 ? 1 : size);
+  if (ptr == nullptr) throw std::bad_alloc();
+  return ptr;
+}
+
+void operator delete(void* ptr) noexcept { std::free(ptr); }
+void operator delete(void* ptr, std::size_t) noexcept { std::free(ptr); }
+
+// 40 records, below a full batch: the output thread takes them at Sync()
+const unsigned kBurstSize = 8;
+
+void LogBurst(logger::LogHandler& handler, const std::string& text,
+              char* mutable_text) {
+  for (unsigned idx = 0; idx < kBurstSize; ++idx) {
+    LogTo(handler, INFO) << static_cast<int>(idx) << idx << -1l << 1ull;
+    LogTo(handler, INFO) << static_cast<short>(idx) << 'c' << true;
+    LogTo(handler, INFO) << 0.5f << 0.25 << 0.125L;
+    LogTo(handler, INFO) << "literal " << text << mutable_text;
+    LogTo(handler, ERROR) << "priority lane " << idx;
+  }
+  handler.Sync();
+}
+
+int main(void) {
+  auto& handler = logger::LogHandler::GetHandler("allocation_test");
+  handler.ClearSinks();
+  handler.AddSink(std::make_shared<logger::NullSink>());
+  handler.Init();
+
+  const std::string text(200, 's');  // no small string optimization
+  char mutable_text[] = "mutable";
+  for (unsigned round = 0; round < 3; ++round) {
+    LogBurst(handler, text, mutable_text);
+  }
+
+  const unsigned long long allocations = allocation_count;
+  for (unsigned round = 0; round < 10; ++round) {
+    LogBurst(handler, text, mutable_text);
+  }
+  CHECK(allocation_count == allocations);
+  CHECK(handler.stats().dropped == 0);
+  return 0;
+}
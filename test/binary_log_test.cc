@@ -0,0 +1,79 @@
+#include "../include/logger.h"
+#include "test_helper.h"
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+
+using logger::LogLevel::DEBUG;
+using logger::LogLevel::INFO;
+using logger::LogLevel::WARN;
+using logger::LogLevel::ERROR;
+
+/**
+ * A text sink and a binary sink get the same records, logpp-decode turns
+ * the binary log back into the same text on one thread and on several.
+ *   usage: binary_log_test <logpp-decode>
+ */
+
+const char* kTextPath = "logpp_binary_log_test.log";
+const char* kBinaryPath = "logpp_binary_log_test.binlog";
+const char* kDecodedPath = "logpp_binary_log_test.decoded";
+// a few MB of blocks, several chunks for the parallel decoder
+const unsigned kRecordCount = 120000;
+
+/**
+ * Every handler opens the binary log as a new segment
+ */
+void LogRun(const std::string& name, unsigned first) {
+  auto& handler = logger::LogHandler::GetHandler(name);
+  handler.ClearSinks();
+  handler.AddSink(std::make_shared<logger::FileSink>(kTextPath));
+  handler.AddSink(std::make_shared<logger::BinaryFileSink>(kBinaryPath));
+  handler.set_log_level(DEBUG);
+  handler.set_max_buffer_size(1000);
+  handler.Init();
+  for (unsigned idx = first; idx < first + kRecordCount / 2; ++idx) {
+    switch (idx % 4) {
+      case 0:
+        LogTo(handler, DEBUG) << "unsigned " << idx << " signed "
+                              << -static_cast<int>(idx);
+        break;
+      case 1:
+        LogTo(handler, INFO) << "double " << idx * 0.25;
+        break;
+      case 2:
+        LogTo(handler, WARN) << "string " << std::string(idx % 40, 'x');
+        break;
+      default:
+        LogTo(handler, ERROR) << idx << ' ' << true << " mixed " << 1.5f;
+    }
+  }
+  handler.Shutdown(std::chrono::seconds(30));
+}
+
+bool Decode(const char* decoder, const char* threads) {
+  const std::string command = std::string("'") + decoder + "' -j " +
+                              threads + " " + kBinaryPath + " " +
+                              kDecodedPath;
+  return std::system(command.c_str()) == 0;
+}
+
+int main(int argc, char* argv[]) {
+  CHECK(argc == 2);
+  std::remove(kTextPath);
+  std::remove(kBinaryPath);
+  LogRun("binary_log_test", 0);
+  LogRun("binary_log_test_appended", kRecordCount / 2);
+  const std::string text = ReadFile(kTextPath);
+  CHECK(!text.empty());
+
+  CHECK(Decode(argv[1], "1"));
+  CHECK(ReadFile(kDecodedPath) == text);
+  CHECK(Decode(argv[1], "4"));
+  CHECK(ReadFile(kDecodedPath) == text);
+
+  std::remove(kTextPath);
+  std::remove(kBinaryPath);
+  std::remove(kDecodedPath);
+  return 0;
+}
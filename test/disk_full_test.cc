@@ -0,0 +1,50 @@
+#include "../include/logger.h"
+#include "test_helper.h"
+#include <future>
+#include <thread>
+
+using logger::LogLevel::INFO;
+
+/**
+ * A sink that can't sync, on a full disk, is tried again after a backoff:
+ * the output thread doesn't spin meanwhile. Files that can't be synced at
+ * all, like /dev/null, don't count as failing.
+ */
+
+const std::chrono::milliseconds kRunTime(1000);
+// a spinning output thread makes hundreds of thousands
+const std::uint64_t kMaxBatches = 200;
+
+int main(void) {
+  auto& full = logger::LogHandler::GetHandler("disk_full_test");
+  full.ClearSinks();
+  full.AddSink(std::make_shared<logger::FileSink>("/dev/full"));
+  full.set_durability(logger::LogHandler::Durability::PERIODIC);
+  full.set_sync_period(1);
+  full.set_flush_interval(std::chrono::milliseconds(100));
+  full.Init();
+  for (unsigned idx = 0; idx < 100; ++idx) {
+    LogTo(full, INFO) << "record " << idx;
+  }
+  // waits for a disk that never frees up, until Shutdown()
+  auto synced = std::async(std::launch::async, [&full] { full.Sync(); });
+  CHECK(synced.wait_for(kRunTime) == std::future_status::timeout);
+  CHECK(full.stats().batches < kMaxBatches);
+  full.Shutdown(std::chrono::seconds(1));
+  synced.wait();
+  CHECK(full.stats().lost_bytes > 0);
+
+  auto& null = logger::LogHandler::GetHandler("disk_full_test_null");
+  null.ClearSinks();
+  null.AddSink(std::make_shared<logger::FileSink>("/dev/null"));
+  null.set_durability(logger::LogHandler::Durability::PERIODIC);
+  null.set_sync_period(1);
+  null.set_flush_interval(std::chrono::milliseconds(100));
+  null.Init();
+  LogTo(null, INFO) << "record";
+  auto null_synced = std::async(std::launch::async, [&null] { null.Sync(); });
+  CHECK(null_synced.wait_for(kRunTime) == std::future_status::ready);
+  std::this_thread::sleep_for(kRunTime);
+  CHECK(null.stats().batches < kMaxBatches);
+  return 0;
+}
@@ -0,0 +1,135 @@
+#include "../include/logger.h"
+#include "test_helper.h"
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+using logger::LogLevel::INFO;
+
+/**
+ * Sweeps sinks, thread counts and payloads, one named handler per run.
+ * Prints one CSV line per run: throughput from the first Log() until the
+ * sinks got and synced every record, and percentiles of the time one Log()
+ * statement takes in the calling thread.
+ */
+
+const char* kSinks[] = {"null", "file", "binary"};
+const char* kPayloads[] = {"int", "double", "str16", "str128", "mixed"};
+const std::string kString16(16, 'x');
+const std::string kString128(128, 'x');
+
+std::shared_ptr<logger::Sink> MakeSink(const std::string& sink,
+                                       unsigned run) {
+  const std::string path = "bench/" + std::to_string(run) + "." + sink;
+  if (sink == "file") return std::make_shared<logger::FileSink>(path);
+  if (sink == "binary") return std::make_shared<logger::BinaryFileSink>(path);
+  return std::make_shared<logger::NullSink>();
+}
+
+/**
+ * Time each statement alone, the payload is chosen before the loop
+ */
+template <typename Statement>
+void TimeEach(unsigned count, Statement statement,
+              std::vector<long long>& latencies) {
+  for (unsigned idx = 0; idx < count; ++idx) {
+    const long long start = SteadyNow();
+    statement(idx);
+    latencies.push_back(SteadyNow() - start);
+  }
+}
+
+void Produce(logger::LogHandler& handler, const std::string& payload,
+             unsigned count, std::vector<long long>& latencies) {
+  latencies.reserve(count);
+  if (payload == "int") {
+    TimeEach(count, [&handler](unsigned idx) { LogTo(handler, INFO) << idx; },
+             latencies);
+  } else if (payload == "double") {
+    TimeEach(count,
+             [&handler](unsigned idx) { LogTo(handler, INFO) << idx * 0.5; },
+             latencies);
+  } else if (payload == "str16") {
+    TimeEach(count,
+             [&handler](unsigned) { LogTo(handler, INFO) << kString16; },
+             latencies);
+  } else if (payload == "str128") {
+    TimeEach(count,
+             [&handler](unsigned) { LogTo(handler, INFO) << kString128; },
+             latencies);
+  } else {
+    TimeEach(count,
+             [&handler](unsigned idx) {
+               LogTo(handler, INFO) << "request " << idx << " took "
+                                    << idx * 0.5 << "ms from " << kString16;
+             },
+             latencies);
+  }
+}
+
+void Run(unsigned run, const std::string& sink, unsigned thread_count,
+         const std::string& payload, unsigned record_count) {
+  auto& handler =
+      logger::LogHandler::GetHandler("latency_benchmark" + std::to_string(run));
+  handler.ClearSinks();
+  handler.AddSink(MakeSink(sink, run));
+  handler.Init();
+
+  const unsigned per_thread = record_count / thread_count;
+  std::vector<std::vector<long long>> latencies(thread_count);
+  std::vector<std::thread> threads;
+  const long long start = SteadyNow();
+  for (unsigned idx = 0; idx < thread_count; ++idx) {
+    threads.emplace_back(Produce, std::ref(handler), std::cref(payload),
+                         per_thread, std::ref(latencies[idx]));
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  handler.Sync();  // every record is written once it returns
+  const double seconds = (SteadyNow() - start) / 1e9;
+
+  std::vector<long long> merged;
+  for (const auto& thread_latencies : latencies) {
+    merged.insert(merged.end(), thread_latencies.begin(),
+                  thread_latencies.end());
+  }
+  std::sort(merged.begin(), merged.end());
+  auto percentile = [&merged](double p) {
+    if (merged.empty()) return 0ll;
+    return merged[static_cast<std::size_t>(p * (merged.size() - 1))];
+  };
+  std::cout << sink << "," << thread_count << "," << payload << ","
+            << merged.size() << "," << seconds << ","
+            << static_cast<long long>(merged.size() / seconds) << ","
+            << percentile(0.5) << "," << percentile(0.99) << ","
+            << percentile(0.999) << "," << percentile(1) << std::endl;
+  // its output thread and files would pile up until the last run
+  handler.Shutdown(std::chrono::seconds(5));
+}
+
+int main(int argc, char* argv[]) {
+  const unsigned record_count = argc > 1 ? std::atoi(argv[1]) : 200000;
+  const unsigned core_count =
+      std::max(1u, std::thread::hardware_concurrency());
+  std::vector<unsigned> thread_counts;
+  for (unsigned count = 1; count < core_count; count *= 2) {
+    thread_counts.push_back(count);
+  }
+  thread_counts.push_back(core_count);
+
+  std::cout << "sink,threads,payload,records,seconds,records_per_sec,"
+               "p50_ns,p99_ns,p999_ns,max_ns"
+            << std::endl;
+  unsigned run = 0;
+  for (const char* sink : kSinks) {
+    for (const unsigned thread_count : thread_counts) {
+      for (const char* payload : kPayloads) {
+        Run(run++, sink, thread_count, payload, record_count);
+      }
+    }
+  }
+  return 0;
+}
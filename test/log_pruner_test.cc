@@ -0,0 +1,83 @@
+#include "../lib/log_pruner.h"
+#include "test_helper.h"
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/**
+ * Only rotated copies of the log file go, oldest first, until both the
+ * count and the size of the directory are within the limits
+ */
+
+const char* kOtherFiles[] = {"app.log", "app.log.bin", "app.log.lock",
+                             "other.log.1"};
+// oldest first
+const char* kRotatedFiles[] = {"app.log.5", "app.log.20240130.xz",
+                               "app.log-20240131", "app.log.2.gz",
+                               "app.log.1"};
+
+void MakeFile(const std::string& path, std::size_t size, time_t mtime) {
+  std::ofstream(path) << std::string(size, 'x');
+  const timespec times[2] = {{mtime, 0}, {mtime, 0}};
+  utimensat(AT_FDCWD, path.c_str(), times, 0);
+}
+
+bool Exists(const std::string& path) {
+  return access(path.c_str(), F_OK) == 0;
+}
+
+/**
+ * Let the pruner run its first pass
+ */
+void Prune(const std::string& dir, std::uint64_t max_dir_size,
+           unsigned max_rotated_files, std::uint64_t expected) {
+  logger::LogPruner pruner(dir, "app.log", max_dir_size, max_rotated_files);
+  for (unsigned wait = 0; wait < 200 && pruner.pruned_files() < expected;
+       ++wait) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+  // nothing more to go
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+}
+
+int main(void) {
+  char dir_template[] = "/tmp/logpp_pruner_test.XXXXXX";
+  const std::string dir = mkdtemp(dir_template);
+  const time_t now = time(nullptr);
+  for (const char* name : kOtherFiles) {
+    MakeFile(dir + "/" + name, 100, now - 3600);  // older than any copy
+  }
+  time_t mtime = now - 1000;
+  for (const char* name : kRotatedFiles) {
+    MakeFile(dir + "/" + name, 1000, mtime++);
+  }
+
+  // 5 copies, 3 kept
+  Prune(dir, 0, 3, 2);
+  CHECK(!Exists(dir + "/app.log.5"));
+  CHECK(!Exists(dir + "/app.log.20240130.xz"));
+  CHECK(Exists(dir + "/app.log-20240131"));
+
+  // 3400 bytes, the oldest copy brings it under 2500
+  Prune(dir, 2500, 0, 1);
+  CHECK(!Exists(dir + "/app.log-20240131"));
+  CHECK(Exists(dir + "/app.log.2.gz"));
+  CHECK(Exists(dir + "/app.log.1"));
+
+  // no copy is left to bring it under 300, the other files stay
+  Prune(dir, 300, 0, 2);
+  CHECK(!Exists(dir + "/app.log.2.gz"));
+  CHECK(!Exists(dir + "/app.log.1"));
+  for (const char* name : kOtherFiles) {
+    CHECK(Exists(dir + "/" + name));
+    unlink((dir + "/" + name).c_str());
+  }
+  rmdir(dir.c_str());
+  return 0;
+}
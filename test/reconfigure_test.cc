@@ -0,0 +1,128 @@
+#include "../include/logger.h"
+#include "test_helper.h"
+#include <atomic>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <thread>
+
+using logger::LogLevel::DEBUG;
+using logger::LogLevel::INFO;
+using logger::LogLevel::WARN;
+
+const char* kConfigPath = "logpp_reconfigure_test.conf";
+const char* kFirstLogPath = "logpp_reconfigure_test_1.log";
+const char* kSecondLogPath = "logpp_reconfigure_test_2.log";
+
+/**
+ * Sinks and settings changed on a running handler apply from the next
+ * batch on, while other threads keep logging
+ */
+
+class CountingSink : public logger::Sink {
+ public:
+  CountingSink() : opened(0), closed(0), records(0) {}
+
+  void Open() override { ++opened; }
+  void Write(const logger::LogRecord*, std::size_t count) override {
+    records += count;
+  }
+  void Flush() override {}
+  void Close() override { ++closed; }
+
+  std::atomic<unsigned> opened;
+  std::atomic<unsigned> closed;
+  std::atomic<std::size_t> records;
+};
+
+/**
+ * Replace the config file the way editors save it
+ */
+void WriteConfig(const std::string& text) {
+  const std::string temporary = std::string(kConfigPath) + ".tmp";
+  std::ofstream(temporary) << text;
+  std::rename(temporary.c_str(), kConfigPath);
+}
+
+int main(void) {
+  auto& handler = logger::LogHandler::GetHandler("reconfigure_test");
+  auto first = std::make_shared<CountingSink>();
+  auto second = std::make_shared<CountingSink>();
+  handler.ClearSinks();
+  handler.AddSink(first);
+  handler.Init();
+  CHECK(first->opened == 1);
+
+  std::atomic<bool> is_stop(false);
+  std::thread producer([&handler, &is_stop] {
+    while (!is_stop) {
+      LogTo(handler, INFO) << "background";
+    }
+  });
+
+  LogTo(handler, DEBUG) << "filtered";
+  handler.set_log_level(DEBUG);
+  handler.set_max_buffer_size(10);
+  handler.set_flush_interval(std::chrono::milliseconds(1));
+  handler.AddSink(second);
+  CHECK(second->opened == 1);
+  LogTo(handler, DEBUG) << "written";
+  handler.Flush();
+  CHECK(second->records > 0);
+
+  handler.RemoveSink(first);
+  LogTo(handler, INFO) << "one more batch";
+  handler.Flush();
+  CHECK(first->closed == 1);
+  const std::size_t first_records = first->records;
+  handler.Flush();
+  CHECK(first->records == first_records);
+
+  is_stop = true;
+  producer.join();
+  CHECK(handler.Shutdown(std::chrono::seconds(5)) == 0);
+  CHECK(second->closed == 1);
+  CHECK(first->closed == 1);
+  CHECK(handler.stats().dropped == 0);
+
+  // the file applies at Init and again once it changes, the handler's
+  // section over the common lines
+  WriteConfig(
+      "level = ERROR\nflush_interval_us = 1000\n"
+      "[reconfigure_test_file]\nlevel = WARN\nsink = null\n");
+  auto& file_handler = logger::LogHandler::GetHandler("reconfigure_test_file");
+  file_handler.set_config_file(kConfigPath);
+  file_handler.Init();
+  CHECK(file_handler.IsLevelEnabled(WARN));
+  CHECK(!file_handler.IsLevelEnabled(INFO));
+
+  WriteConfig("level = DEBUG\nflush_interval_us = 1000\n");
+  for (unsigned wait = 0; wait < 200 && !file_handler.IsLevelEnabled(DEBUG);
+       ++wait) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+  CHECK(file_handler.IsLevelEnabled(DEBUG));
+  std::remove(kConfigPath);
+
+  // the log file switched while running, the old one is closed
+  std::remove(kFirstLogPath);
+  std::remove(kSecondLogPath);
+  auto& log_file_handler =
+      logger::LogHandler::GetHandler("reconfigure_test_log_file");
+  log_file_handler.set_output(logger::LogHandler::Output::CONSOLE, false);
+  log_file_handler.set_log_file(kFirstLogPath);
+  log_file_handler.Init();
+  LogTo(log_file_handler, INFO) << "before the switch";
+  log_file_handler.Flush();
+  log_file_handler.set_log_file(kSecondLogPath);
+  LogTo(log_file_handler, INFO) << "after the switch";
+  CHECK(log_file_handler.Shutdown(std::chrono::seconds(5)) == 0);
+  const std::string first_text = ReadFile(kFirstLogPath);
+  const std::string second_text = ReadFile(kSecondLogPath);
+  CHECK(first_text.find("before the switch") != std::string::npos);
+  CHECK(first_text.find("after the switch") == std::string::npos);
+  CHECK(second_text.find("after the switch") != std::string::npos);
+  std::remove(kFirstLogPath);
+  std::remove(kSecondLogPath);
+  return 0;
+}
@@ -0,0 +1,70 @@
+#include "../include/logger.h"
+#include "../include/shm_ring_reader.h"
+#include "test_helper.h"
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+
+using logger::LogLevel::INFO;
+auto& logging = logger::LogHandler::GetHandler();
+
+const char* kRingName = "/logpp_shm_latency_benchmark";
+const unsigned kMsgCount = 100000;
+
+/**
+ * Reader side, as a monitoring agent would do it: every line carries the
+ * time Log() was called, the difference to now is the end-to-end latency
+ */
+void ReadRing(std::vector<long long>& latencies, std::atomic<bool>& is_ready) {
+  logger::ShmRingReader reader;
+  while (!reader.Open(kRingName)) {
+    std::this_thread::yield();
+  }
+  is_ready = true;
+
+  std::string line;
+  while (latencies.size() + reader.lost_records() < kMsgCount) {
+    if (!reader.Next(line)) {
+      std::this_thread::yield();
+      continue;
+    }
+    const long long now = SteadyNow();
+    const auto pos = line.rfind(">> ");
+    latencies.push_back(now - std::atoll(line.c_str() + pos + 3));
+  }
+  std::cout << "lost " << reader.lost_records() << std::endl;
+}
+
+int main(void) {
+  logging.ClearSinks();
+  logging.AddSink(std::make_shared<logger::ShmRingSink>(kRingName));
+  logging.set_max_buffer_size(1);  // measure the ring, not the batching
+  logging.Init();
+
+  std::vector<long long> latencies;
+  latencies.reserve(kMsgCount);
+  std::atomic<bool> is_ready(false);
+  std::thread reader(ReadRing, std::ref(latencies), std::ref(is_ready));
+  while (!is_ready) {
+    std::this_thread::yield();
+  }
+
+  for (unsigned idx = 0; idx < kMsgCount; ++idx) {
+    Log(INFO) << SteadyNow();
+    if (idx % 64 == 0) std::this_thread::yield();  // let the ring drain
+  }
+  reader.join();
+
+  std::sort(latencies.begin(), latencies.end());
+  auto percentile = [&latencies](double p) {
+    if (latencies.empty()) return 0ll;
+    return latencies[static_cast<std::size_t>(p * (latencies.size() - 1))];
+  };
+  std::cout << "Log() to reader latency (ns) over " << latencies.size()
+            << " lines: p50 " << percentile(0.5) << " p99 "
+            << percentile(0.99) << " p99.9 " << percentile(0.999) << " max "
+            << percentile(1) << std::endl;
+  return 0;
+}
@@ -0,0 +1,62 @@
+#include "../include/logger.h"
+#include "test_helper.h"
+#include <atomic>
+#include <thread>
+
+using logger::LogLevel::INFO;
+
+/**
+ * Shutdown() drains a batch at a time: a slow sink can't hold it past the
+ * deadline, and what is left is counted as lost
+ */
+
+const unsigned kRecordCount = 1000;
+const unsigned kBatchSize = 20;
+
+class SlowSink : public logger::Sink {
+ public:
+  SlowSink() : records(0), is_writing(false), release_time(0) {}
+
+  // the first batch waits for the release time, the queue fills up
+  // meanwhile
+  void Write(const logger::LogRecord*, std::size_t count) override {
+    is_writing = true;
+    while (release_time == 0 || SteadyNow() < release_time) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(count));
+    records += count;
+  }
+  void Flush() override {}
+
+  std::atomic<std::size_t> records;
+  std::atomic<bool> is_writing;
+  std::atomic<long long> release_time;
+};
+
+int main(void) {
+  auto& handler = logger::LogHandler::GetHandler("shutdown_test");
+  auto sink = std::make_shared<SlowSink>();
+  handler.ClearSinks();
+  handler.AddSink(sink);
+  handler.set_max_buffer_size(kBatchSize);
+  handler.Init();
+  for (unsigned idx = 0; idx < kRecordCount; ++idx) {
+    LogTo(handler, INFO) << "record " << idx;
+    while (idx == kBatchSize - 1 && !sink->is_writing) {
+      std::this_thread::yield();
+    }
+  }
+
+  const long long start = SteadyNow();
+  // Shutdown() begins meanwhile
+  sink->release_time = start + 50000000;
+  const std::uint64_t lost = handler.Shutdown(std::chrono::milliseconds(200));
+  const long long elapsed_ms = (SteadyNow() - start) / 1000000;
+  // a batch of 20 records takes 20 ms
+  CHECK(elapsed_ms < 600);
+  CHECK(lost > 0);
+  CHECK(sink->records + lost == kRecordCount);
+  CHECK(handler.stats().dropped == lost);
+  return 0;
+}
@@ -0,0 +1,109 @@
+#include "../include/log_stream.h"
+#include "../lib/log_format.h"
+#include "test_helper.h"
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <new>
+#include <string>
+#include <vector>
+
+using logger::LogLevel::INFO;
+using logger::LogLevel::ERROR;
+
+/**
+ * Every stage of a record on its own, as CSV: nanoseconds and heap
+ * allocations per record. Stages are
+ *   stream   LogStream construction, operator<< chain, filtered destructor
+ *   format   LogFormatter::Format to a text line
+ *   enqueue  LogHandler::Log into a queue drained to a NullSink
+ *   queue    the same, until the output thread took every record
+ *   file     FileSink::Write and Flush, 64 records per batch
+ *   binary   BinaryFileSink::Write and Flush, 64 records per batch
+ * logger.h isn't included, its Log() macro would hide LogHandler::Log().
+ */
+
+std::atomic<unsigned long long> allocation_count(0);
+
+void* operator new(std::size_t size) {
+  ++allocation_count;
+  void* ptr = std::malloc(size == 0 ? 1 : size);
+  if (ptr == nullptr) throw std::bad_alloc();
+  return ptr;
+}
+
+void operator delete(void* ptr) noexcept { std::free(ptr); }
+void operator delete(void* ptr, std::size_t) noexcept { std::free(ptr); }
+
+const unsigned kBatchSize = 64;
+
+template <typename Body>
+void Measure(const char* stage, unsigned count, Body body) {
+  const unsigned long long allocations = allocation_count;
+  const long long start = SteadyNow();
+  body(count);
+  const long long elapsed = SteadyNow() - start;
+  std::cout << stage << "," << static_cast<double>(elapsed) / count << ","
+            << static_cast<double>(allocation_count - allocations) / count
+            << std::endl;
+}
+
+int main(int argc, char* argv[]) {
+  const unsigned count = argc > 1 ? std::atoi(argv[1]) : 1000000;
+  std::vector<logger::LogRecord> records;
+  for (unsigned idx = 0; idx < kBatchSize; ++idx) {
+    records.push_back(MakeRecord(idx));
+  }
+
+  auto& filtered = logger::LogHandler::GetHandler("stage_benchmark_filtered");
+  filtered.set_log_level(ERROR);
+  auto& queued = logger::LogHandler::GetHandler("stage_benchmark_queued");
+  queued.ClearSinks();
+  queued.AddSink(std::make_shared<logger::NullSink>());
+  queued.Init();
+  logger::LogFormatter formatter;
+  std::string line;
+  logger::FileSink file_sink("bench/stage.log");
+  file_sink.Open();
+  logger::BinaryFileSink binary_sink("bench/stage.binlog");
+  binary_sink.Open();
+
+  std::cout << "stage,ns_per_record,allocations_per_record" << std::endl;
+  Measure("stream", count, [&filtered](unsigned count) {
+    for (unsigned idx = 0; idx < count; ++idx) {
+      logger::LogStream(filtered, INFO, __FILE__, __func__, __LINE__)
+          << "request " << idx << " took " << idx * 0.5 << "ms";
+    }
+  });
+  Measure("format", count, [&records, &formatter, &line](unsigned count) {
+    for (unsigned idx = 0; idx < count; ++idx) {
+      line.clear();
+      formatter.Format(records[idx % kBatchSize], false, line);
+    }
+  });
+  Measure("enqueue", count, [&records, &queued](unsigned count) {
+    for (unsigned idx = 0; idx < count; ++idx) {
+      queued.Log(records[idx % kBatchSize]);
+    }
+  });
+  Measure("queue", count, [&records, &queued](unsigned count) {
+    for (unsigned idx = 0; idx < count; ++idx) {
+      queued.Log(records[idx % kBatchSize]);
+    }
+    queued.Sync();
+  });
+  Measure("file", count, [&records, &file_sink](unsigned count) {
+    for (unsigned idx = 0; idx < count; idx += kBatchSize) {
+      file_sink.Write(records.data(), kBatchSize);
+      file_sink.Flush();
+    }
+  });
+  Measure("binary", count, [&records, &binary_sink](unsigned count) {
+    for (unsigned idx = 0; idx < count; idx += kBatchSize) {
+      binary_sink.Write(records.data(), kBatchSize);
+      binary_sink.Flush();
+    }
+  });
+  return 0;
+}
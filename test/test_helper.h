@@ -0,0 +1,58 @@
+#ifndef LOGGING_PLUS_PLUS_TEST_HELPER_H_
+#define LOGGING_PLUS_PLUS_TEST_HELPER_H_
+
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include "../include/log_record.h"
+
+/**
+ * Shared by the tests and benchmarks
+ */
+
+// in main(): report the line and fail the test
+#define CHECK(condition)                                             \
+  if (!(condition)) {                                                \
+    std::cerr << "check failed: " #condition " at line " << __LINE__ \
+              << std::endl;                                          \
+    return 1;                                                        \
+  }
+
+inline long long SteadyNow() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+// the whole file, empty if it can't be read
+inline std::string ReadFile(const char* path) {
+  std::ifstream file(path);
+  std::ostringstream content;
+  content << file.rdbuf();
+  return content.str();
+}
+
+/**
+ * A record as Log() makes it: "request idx took idx/2ms", logged now
+ */
+inline logger::LogRecord MakeRecord(unsigned idx) {
+  logger::LogRecord record;
+  record.level = logger::LogLevel::INFO;
+  record.line = __LINE__;
+  record.file = __FILE__;
+  record.func = __func__;
+  record.time = std::chrono::duration_cast<std::chrono::microseconds>(
+                    std::chrono::system_clock::now().time_since_epoch())
+                    .count();
+  record.args_size = 0;
+  record.AppendString("request ", 8);
+  record.AppendUnsigned(idx);
+  record.AppendString(" took ", 6);
+  record.AppendDouble(idx * 0.5);
+  record.AppendString("ms", 2);
+  return record;
+}
+
+#endif /* LOGGING_PLUS_PLUS_TEST_HELPER_H_ */
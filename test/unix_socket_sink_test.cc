@@ -0,0 +1,125 @@
+#include "../include/logger.h"
+#include "test_helper.h"
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <iostream>
+#include <mutex>
+#include <thread>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+const char* kSocketPath = "logpp_collector_test.sock";
+
+/**
+ * Tiny local collector: accepts one client at a time and keeps its lines
+ */
+class CollectorStub {
+ public:
+  CollectorStub() : listen_fd_(-1), client_fd_(-1), is_stop_(false) {
+    unlink(kSocketPath);
+    sockaddr_un address = {};
+    address.sun_family = AF_UNIX;
+    std::strncpy(address.sun_path, kSocketPath, sizeof(address.sun_path) - 1);
+    listen_fd_ = socket(AF_UNIX, SOCK_STREAM, 0);
+    bind(listen_fd_, reinterpret_cast<sockaddr*>(&address), sizeof(address));
+    listen(listen_fd_, 1);
+    thread_ = std::thread(&CollectorStub::Run, this);
+  }
+  ~CollectorStub() {
+    is_stop_ = true;
+    shutdown(listen_fd_, SHUT_RDWR);
+    {
+      std::lock_guard<std::mutex> lock(mtx_);
+      if (client_fd_ >= 0) shutdown(client_fd_, SHUT_RDWR);
+    }
+    thread_.join();
+    close(listen_fd_);
+    unlink(kSocketPath);
+  }
+
+  std::size_t LineCount() {
+    std::lock_guard<std::mutex> lock(mtx_);
+    return std::count(received_.begin(), received_.end(), '\n');
+  }
+
+  std::string Received() {
+    std::lock_guard<std::mutex> lock(mtx_);
+    return received_;
+  }
+
+ private:
+  void Run() {
+    while (!is_stop_) {
+      const int fd = accept(listen_fd_, nullptr, nullptr);
+      if (fd < 0) return;
+      {
+        std::lock_guard<std::mutex> lock(mtx_);
+        client_fd_ = fd;
+      }
+      char buffer[4096];
+      ssize_t size;
+      while ((size = read(fd, buffer, sizeof(buffer))) > 0) {
+        std::lock_guard<std::mutex> lock(mtx_);
+        received_.append(buffer, size);
+      }
+      std::lock_guard<std::mutex> lock(mtx_);
+      close(fd);
+      client_fd_ = -1;
+    }
+  }
+
+  int listen_fd_;
+  int client_fd_;
+  std::atomic<bool> is_stop_;
+  std::mutex mtx_;
+  std::string received_;
+  std::thread thread_;
+};
+
+// flush until the collector has count lines, or give up after 3 seconds
+bool WaitForLines(logger::UnixSocketSink& sink, CollectorStub& collector,
+                  std::size_t count) {
+  for (int retry = 0; retry < 300; ++retry) {
+    sink.Flush();
+    if (collector.LineCount() >= count) return true;
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+  return false;
+}
+
+int main(void) {
+  unlink(kSocketPath);
+  logger::UnixSocketSink sink(kSocketPath);
+
+  // nobody listens yet, records are kept
+  logger::LogRecord records[] = {MakeRecord(0), MakeRecord(1), MakeRecord(2)};
+  sink.Write(records, 3);
+  CHECK(!sink.is_connected());
+
+  {
+    CollectorStub collector;
+    CHECK(WaitForLines(sink, collector, 3));
+    CHECK(sink.is_connected());
+    CHECK(collector.Received().find(">> request 2 took ") != std::string::npos);
+  }
+
+  // collector restarted, buffered records arrive on the new connection
+  records[0] = MakeRecord(3);
+  sink.Write(records, 1);
+  {
+    CollectorStub collector;
+    CHECK(WaitForLines(sink, collector, 1));
+    CHECK(collector.Received().find(">> request 3 took ") != std::string::npos);
+  }
+  CHECK(sink.dropped_records() == 0);
+
+  // bounded buffer while disconnected
+  logger::UnixSocketSink small_sink(kSocketPath, 200);
+  small_sink.Write(records, 1);
+  small_sink.Write(records, 1);
+  small_sink.Write(records, 1);
+  CHECK(small_sink.dropped_records() > 0);
+  return 0;
+}
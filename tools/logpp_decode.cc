@@ -0,0 +1,219 @@
+#include <atomic>
+#include <condition_variable>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "../lib/binary_log.h"
+
+namespace {
+
+const std::size_t kChunkSize = 1 << 20;  // encoded bytes decoded per task
+const long kMaxThreads = 1024;
+
+/**
+ * A run of consecutive blocks of one segment, decoded by a single worker
+ */
+struct Chunk {
+  const char* begin;
+  const char* end;
+  std::shared_ptr<const logger::Dictionary> dictionary;
+  std::string text;
+  bool is_done;
+  bool is_ok;
+};
+
+/**
+ * Walk block headers and dictionaries only, skipping record data
+ */
+bool SplitChunks(const char* begin, const char* end,
+                 std::vector<Chunk>& chunks) {
+  std::shared_ptr<logger::Dictionary> dictionary;
+  const char* pos = begin;
+  while (pos < end) {
+    const std::size_t left = end - pos;
+    if (logger::IsSegmentHeader(pos, left)) {
+      dictionary = std::make_shared<logger::Dictionary>();
+      pos += logger::kSegmentHeaderSize;
+      continue;
+    }
+
+    logger::BlockHeader header;
+    if (!dictionary || !logger::ReadBlockHeader(pos, left, header) ||
+        !logger::ReadDictionary(pos + logger::kBlockHeaderSize,
+                                header.dict_size, *dictionary)) {
+      std::cerr << "corrupted block at offset " << pos - begin << std::endl;
+      return false;
+    }
+    const char* next = pos + logger::kBlockHeaderSize + header.dict_size +
+                       header.data_size;
+    // later blocks only add call sites, the final segment dictionary
+    // serves every block of the segment
+    if (chunks.empty() || chunks.back().dictionary != dictionary ||
+        chunks.back().end != pos ||
+        static_cast<std::size_t>(pos - chunks.back().begin) >= kChunkSize) {
+      chunks.push_back(Chunk{pos, next, dictionary, "", false, false});
+    } else {
+      chunks.back().end = next;
+    }
+    pos = next;
+  }
+  return true;
+}
+
+bool DecodeChunk(Chunk& chunk) {
+  logger::LogFormatter formatter;
+  const char* pos = chunk.begin;
+  while (pos < chunk.end) {
+    logger::BlockHeader header;
+    if (!logger::ReadBlockHeader(pos, chunk.end - pos, header)) return false;
+    const char* data = pos + logger::kBlockHeaderSize + header.dict_size;
+    if (!logger::DecodeBlockData(data, header, *chunk.dictionary, formatter,
+                                 chunk.text)) {
+      return false;
+    }
+    pos = data + header.data_size;
+  }
+  return true;
+}
+
+/**
+ * Decode chunks on a pool of workers, write their text in file order.
+ * Workers never run more than a window of chunks ahead of the writer.
+ */
+bool DecodeParallel(std::vector<Chunk>& chunks, unsigned thread_count,
+                    std::ostream& output) {
+  std::mutex mtx;
+  std::condition_variable done_cv;     // condition: a chunk is decoded
+  std::condition_variable written_cv;  // condition: a chunk is written
+  std::atomic<std::size_t> next(0);
+  std::size_t written = 0;
+  bool is_abort = false;
+  const std::size_t window = thread_count * 4;
+
+  auto worker = [&]() {
+    while (true) {
+      const std::size_t idx = next++;
+      if (idx >= chunks.size()) return;
+      {
+        std::unique_lock<std::mutex> lock(mtx);
+        while (!is_abort && idx >= written + window) {
+          written_cv.wait(lock);
+        }
+        if (is_abort) return;
+      }
+      const bool is_ok = DecodeChunk(chunks[idx]);
+      std::lock_guard<std::mutex> lock(mtx);
+      chunks[idx].is_ok = is_ok;
+      chunks[idx].is_done = true;
+      done_cv.notify_all();
+    }
+  };
+  std::vector<std::thread> workers;
+  for (unsigned idx = 0; idx < thread_count; ++idx) {
+    workers.emplace_back(worker);
+  }
+
+  bool is_ok = true;
+  for (auto& chunk : chunks) {
+    {
+      std::unique_lock<std::mutex> lock(mtx);
+      while (!chunk.is_done) {
+        done_cv.wait(lock);
+      }
+    }
+    if (!chunk.is_ok) {
+      std::cerr << "corrupted block data" << std::endl;
+      is_ok = false;
+      break;
+    }
+    output << chunk.text;
+    std::string().swap(chunk.text);
+
+    std::lock_guard<std::mutex> lock(mtx);
+    ++written;
+    written_cv.notify_all();
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(mtx);
+    is_abort = true;
+    written_cv.notify_all();
+  }
+  for (auto& thread : workers) {
+    thread.join();
+  }
+  return is_ok;
+}
+}
+
+/**
+ * Turn a binary log back into the text log format
+ *   usage: logpp-decode [-j threads] <binary log> [text log]
+ * threads from 1 to kMaxThreads, the number of cores by default
+ */
+int main(int argc, char* argv[]) {
+  unsigned thread_count = std::thread::hardware_concurrency();
+  if (thread_count == 0) thread_count = 1;
+  int arg = 1;
+  bool is_bad_threads = false;
+  if (argc > 2 && std::strcmp(argv[1], "-j") == 0) {
+    char* end;
+    const long count = std::strtol(argv[2], &end, 10);
+    is_bad_threads = end == argv[2] || *end != '\0' || count < 1 ||
+                     count > kMaxThreads;
+    thread_count = is_bad_threads ? 1 : count;
+    arg = 3;
+  }
+  if (is_bad_threads || argc - arg < 1 || argc - arg > 2) {
+    std::cerr << "usage: " << argv[0]
+              << " [-j threads] <binary log> [text log]" << std::endl;
+    return 2;
+  }
+  const char* input_path = argv[arg];
+  const char* output_path = argc - arg == 2 ? argv[arg + 1] : nullptr;
+
+  const int fd = open(input_path, O_RDONLY);
+  struct stat fileStat;
+  if (fd < 0 || fstat(fd, &fileStat) < 0) {
+    std::cerr << "cannot open " << input_path << std::endl;
+    return 1;
+  }
+  const std::size_t size = fileStat.st_size;
+  const char* content = nullptr;
+  if (size > 0) {
+    void* mapped = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (mapped == MAP_FAILED) {
+      std::cerr << "cannot map " << input_path << std::endl;
+      return 1;
+    }
+    madvise(mapped, size, MADV_SEQUENTIAL);
+    content = static_cast<const char*>(mapped);
+  }
+  close(fd);
+
+  std::ofstream output_file;
+  if (output_path != nullptr) {
+    output_file.open(output_path, std::ofstream::out | std::ofstream::trunc);
+    if (!output_file) {
+      std::cerr << "cannot open " << output_path << std::endl;
+      return 1;
+    }
+  }
+  std::ostream& output = output_path != nullptr ? output_file : std::cout;
+
+  std::vector<Chunk> chunks;
+  const bool is_split = SplitChunks(content, content + size, chunks);
+  // decode what precedes a corrupted block anyway
+  const bool is_decoded = DecodeParallel(chunks, thread_count, output);
+  output << std::flush;
+  return is_split && is_decoded && output ? 0 : 1;
+}
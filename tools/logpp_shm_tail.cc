@@ -0,0 +1,37 @@
+#include <chrono>
+#include <iostream>
+#include <thread>
+#include "../include/shm_ring_reader.h"
+
+/**
+ * Follow the lines a ShmRingSink publishes
+ *   usage: logpp-shm-tail <shared memory name>
+ */
+int main(int argc, char* argv[]) {
+  if (argc != 2) {
+    std::cerr << "usage: " << argv[0] << " <shared memory name>" << std::endl;
+    return 2;
+  }
+
+  logger::ShmRingReader reader;
+  while (!reader.Open(argv[1])) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  }
+
+  std::string line;
+  std::uint64_t lost_records = 0;
+  while (std::cout) {
+    if (!reader.Next(line)) {
+      std::cout << std::flush;
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+      continue;
+    }
+    if (reader.lost_records() != lost_records) {
+      std::cerr << reader.lost_records() - lost_records << " lines lost"
+                << std::endl;
+      lost_records = reader.lost_records();
+    }
+    std::cout << line;
+  }
+  return 0;
+}